@@ -0,0 +1,207 @@
+/**
+  ******************************************************************************
+  * File Name          : bench.c
+  * Description        : Host micro-benchmarks of protocol and sensor code
+  ******************************************************************************
+  *
+  * Copyright (c) 2016 S54MTB
+  * Licensed under Apache License 2.0
+  * http://www.apache.org/licenses/LICENSE-2.0.html
+  *
+  ******************************************************************************
+
+  bench [-q]
+    -q  short runs, for ctest
+
+  HDLC frame decode and encode, crc16() over 6 to 256 bytes and MS5637
+  compensation in integer and double. Numbers are host times, they rank
+  variants against each other, not the cycle counts on the Cortex-M0.
+  */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "host.h"
+#include "hdlc.h"
+#include "crc.h"
+#include "MS5637.h"
+#include "setup.h"
+
+static double bench_time = 0.2;					// s per measurement
+static volatile uint32_t bench_sink;		// keeps results alive
+
+
+static double bench_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Pseudo random bytes, with flags and escapes among them */
+static void bench_fill(uint8_t *buf, uint16_t len, uint32_t seed)
+{
+	while (len--)
+	{
+		seed = seed * 1103515245 + 12345;
+		*buf++ = (uint8_t)(seed >> 16);
+	}
+}
+
+
+/* crc16() ------------------------------------------------------------------*/
+static void bench_crc16(void)
+{
+	static const uint16_t sizes[] = { 6, 16, 32, 64, 128, 256 };
+	uint8_t buf[256];
+	uint32_t i, n;
+	double t0, t;
+
+	bench_fill(buf, sizeof(buf), 1);
+	printf("crc16() kernel %d backend %d\n", CRC16_KERNEL, CRC16_BACKEND);
+	for (i=0; i<sizeof(sizes)/sizeof(sizes[0]); i++)
+	{
+		n = 0;
+		t0 = bench_now();
+		do
+		{
+			bench_sink += crc16(buf, sizes[i]);
+			n++;
+		} while ((n & 0xff) || ((t = bench_now() - t0) < bench_time));
+		printf("  %3u B  %8.1f ns  %7.1f MB/s\n", sizes[i], 1e9 * t / n, sizes[i] * n / t / 1e6);
+	}
+}
+
+
+/* HDLC ---------------------------------------------------------------------*/
+
+/* Escaped frame for this node with payload of len bytes, returns wire length */
+static uint16_t bench_frame(uint8_t *wire, uint16_t len)
+{
+	uint8_t frame[HDLC_MRU];
+	uint16_t crc, i, n = 0;
+
+	frame[0] = 0x01;
+	frame[1] = SETUP_OWNADDRESS;
+	frame[2] = HDLC_UI_CMD | HDLC_POLL_FLAG;
+	bench_fill(&frame[3], len, len);
+	crc = crc16(frame, len + 3);
+	frame[len + 3] = crc >> 8;
+	frame[len + 4] = crc & 0xff;
+
+	wire[n++] = HDLC_FLAG_SOF;
+	for (i=0; i<len+5; i++)
+	{
+		if ((frame[i] == HDLC_FLAG_SOF) || (frame[i] == HDLC_CONTROL_ESCAPE))
+		{
+			wire[n++] = HDLC_CONTROL_ESCAPE;
+			wire[n++] = frame[i] ^ HDLC_ESCAPE_BIT;
+		}
+		else
+			wire[n++] = frame[i];
+	}
+	wire[n++] = HDLC_FLAG_SOF;
+	return n;
+}
+
+static void bench_hdlc_decode(void)
+{
+	static const uint16_t sizes[] = { 1, 2, HDLC_MAX_REQUEST };
+	uint8_t wire[2*HDLC_MRU + 2];
+	uint16_t n;
+	uint32_t i, frames;
+	double t0, t;
+
+	printf("HDLC decode, hdlc_process_rx() and hdlc_process()\n");
+	for (i=0; i<sizeof(sizes)/sizeof(sizes[0]); i++)
+	{
+		n = bench_frame(wire, sizes[i]);
+		hdlc_init();
+		frames = 0;
+		t0 = bench_now();
+		do
+		{
+			hdlc_process_rx(wire, n);
+			hdlc_process();
+			frames++;
+		} while ((frames & 0xff) || ((t = bench_now() - t0) < bench_time));
+		printf("  %3u B payload  %8.1f ns/frame  %6.2f ns/byte\n", sizes[i], 1e9 * t / frames, 1e9 * t / frames / n);
+	}
+}
+
+static void bench_hdlc_encode(void)
+{
+	static const uint16_t sizes[] = { 1, 6, 12, HDLC_MAX_REPLY };
+	uint8_t payload[HDLC_TX_MTU];
+	uint32_t i, frames;
+	double t0, t;
+
+	printf("HDLC encode, hdlc_tx_frame()\n");
+	hdlc_init();
+	for (i=0; i<sizeof(sizes)/sizeof(sizes[0]); i++)
+	{
+		bench_fill(payload, sizes[i], sizes[i]);
+		frames = 0;
+		t0 = bench_now();
+		do
+		{
+			hdlc_tx_frame(payload, sizes[i]);
+			frames++;
+		} while ((frames & 0xff) || ((t = bench_now() - t0) < bench_time));
+		printf("  %3u B payload  %8.1f ns/frame\n", sizes[i], 1e9 * t / frames);
+	}
+}
+
+
+/* MS5637 -------------------------------------------------------------------*/
+
+/* Raw values around the datasheet example, first and second order ranges */
+static void bench_ms5637(void)
+{
+	static const uint16_t C[8] = { 0, 46372, 43981, 29059, 27842, 31553, 28165, 0 };
+	uint32_t D1[64], D2[64];
+	int32_t T, P;
+	double Td, Pd;
+	uint32_t i, n;
+	double t0, t;
+
+	for (i=0; i<64; i++)
+	{
+		D1[i] = 6465444 + (i * 37813) % 2000000 - 1000000;
+		D2[i] = 8077636 + (i * 51217) % 3000000 - 1500000;
+	}
+	printf("MS5637 compensation\n");
+
+	n = 0;
+	t0 = bench_now();
+	do
+	{
+		MS5637_Calculate_int(C, D1[n & 63], D2[n & 63], &T, &P);
+		bench_sink += T + P;
+		n++;
+	} while ((n & 0xff) || ((t = bench_now() - t0) < bench_time));
+	printf("  MS5637_Calculate_int()  %6.1f ns\n", 1e9 * t / n);
+
+	n = 0;
+	t0 = bench_now();
+	do
+	{
+		MS5637_Calculate((uint16_t *)C, D1[n & 63], D2[n & 63], &Td, &Pd);
+		bench_sink += (uint32_t)(Td + Pd);
+		n++;
+	} while ((n & 0xff) || ((t = bench_now() - t0) < bench_time));
+	printf("  MS5637_Calculate()      %6.1f ns\n", 1e9 * t / n);
+}
+
+
+int main(int argc, char *argv[])
+{
+	if ((argc > 1) && (strcmp(argv[1], "-q") == 0))
+		bench_time = 0.005;
+
+	bench_crc16();
+	bench_hdlc_decode();
+	bench_hdlc_encode();
+	bench_ms5637();
+	return 0;
+}
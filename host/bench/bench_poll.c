@@ -0,0 +1,93 @@
+/**
+  ******************************************************************************
+  * File Name          : bench_poll.c
+  * Description        : Poll latency in simulated time on the sensor models
+  ******************************************************************************
+  *
+  * Copyright (c) 2016 S54MTB
+  * Licensed under Apache License 2.0
+  * http://www.apache.org/licenses/LICENSE-2.0.html
+  *
+  ******************************************************************************
+
+  bench_poll [extra_us]
+    extra_us  HDC1080 conversions take this much longer than typical
+
+  The whole firmware runs on the virtual clock with the MS5637 and HDC1080
+  models of sim/. Every measurement command is polled from the background
+  sample and with latency budgets, the table shows the time from the end of
+  the request to the start of the reply, the resolution code (-1 for the
+  background sample) and the conversions and NACKs each poll took. Unlike
+  bench, these numbers follow the firmware timing and hold for the target.
+  */
+#include <stdio.h>
+#include <stdlib.h>
+#include "host.h"
+#include "link.h"
+#include "hdlc.h"
+#include "setup.h"
+#include "sensor_sim.h"
+
+#define CMD_COMPACT			0x80
+
+static sim_ms5637_t ms5637;
+static sim_hdc1080_t hdc1080;
+
+static const struct
+{
+	uint8_t			cmd;
+	const char	*name;
+} bench_cmds[] = {
+	{ 0x30, "Temperature" },
+	{ 0x31, "Humidity" },
+	{ 0x33, "Pressure" },
+	{ 0x34, "pTemperature" },
+};
+static const uint8_t bench_budgets[] = { 0, 10, 15, 20, 30, 40, 60, 80, 120 };
+
+
+static void bench_poll(uint8_t cmd, const char *name, uint8_t budget)
+{
+	uint8_t req[2] = { cmd | CMD_COMPACT, budget };
+	uint8_t reply[HDLC_TX_MTU + 2];
+	uint32_t conv = ms5637.conversions + hdc1080.conversions;
+	uint32_t nacks = hdc1080.nacks;
+	uint64_t t0, t;
+	int n;
+
+	link_send(SETUP_OWNADDRESS, req, budget ? 2 : 1);
+	t0 = host_uart_rx_idle_at();
+	while ((link_pending() == 0) && (host_time_us() < t0 + 1000000ULL))
+		board_loop();
+	t = host_time_us() - t0;
+	board_run_us(20000);
+	n = link_reply(reply, sizeof(reply));
+	if (n < 3 + 4)
+	{
+		printf("  %-12s %3u ms  no reply\n", name, budget);
+		return;
+	}
+	printf("  %-12s %3u ms  %7.2f ms  res %2d  age %5u ms  %u conv  %u NACK\n", name, budget, t / 1000.0,
+	       budget ? reply[n - 3] : -1, reply[n - 2] | (reply[n - 1] << 8),
+	       ms5637.conversions + hdc1080.conversions - conv, hdc1080.nacks - nacks);
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t i, j;
+
+	board_init();
+	sim_ms5637_init(&ms5637, NULL);
+	sim_hdc1080_init(&hdc1080);
+	if (argc > 1)
+		hdc1080.extra_us = strtoul(argv[1], NULL, 0);
+	link_init(SETUP_BAUDRATE);
+	board_start();
+	board_run_us(100000);
+
+	printf("Poll latency, request end to reply start, HDC1080 +%u us\n", hdc1080.extra_us);
+	for (i=0; i<sizeof(bench_cmds)/sizeof(bench_cmds[0]); i++)
+		for (j=0; j<sizeof(bench_budgets); j++)
+			bench_poll(bench_cmds[i].cmd, bench_cmds[i].name, bench_budgets[j]);
+	return 0;
+}
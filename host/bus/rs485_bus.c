@@ -0,0 +1,772 @@
+/**
+  ******************************************************************************
+  * File Name          : rs485_bus.c
+  * Description        : Virtual RS485 multi-drop bus with N firmware nodes
+  ******************************************************************************
+  *
+  * Copyright (c) 2016 S54MTB
+  * Licensed under Apache License 2.0
+  * http://www.apache.org/licenses/LICENSE-2.0.html
+  *
+  ******************************************************************************
+
+  rs485_bus [-n nodes] [-b baud] [-s sweeps] [-t us] [-w ms] [-q steps] [-D] [-v] [-p]
+    -n  nodes on the bus, 1..247, addresses 0x02 up (8)
+    -b  bus rate, set with a broadcast CMD_Baud when not SETUP_BAUDRATE
+    -s  sweeps, every node is polled with CMD_ID once per sweep (1)
+    -t  master turnaround, from the end of a reply to the next request (100)
+    -w  reply timeout in ms (50)
+    -q  lockstep steps per character time (8)
+    -D  last node gets the address of the first one
+    -v  latency of every node
+    -p  no sweeps, the bus is attached to a pty for a real master and runs
+        in real time until interrupted
+
+  Every node is a forked process with the whole firmware on its own
+  virtual clock and simulated USART, built with its address taken from
+  host_node_address. This process is the master and the wire: it collects
+  the characters and driver enable times of all senders, and hands every
+  character to all other nodes once it has ended. A character that
+  overlaps one from another sender, or another sender's driver enable,
+  is a collision and reaches everyone with a framing error and broken
+  data. The DE lead and hold times are those of SETUP_DE_ASSERT and
+  SETUP_DE_DEASSERT, so a master turnaround below the hold time collides.
+
+  The nodes that may answer a request run in lockstep with the wire, in
+  steps of a fraction of a character, so they see characters at most one
+  step late and latencies read up to one step long. All other nodes only listen and are brought up to the same time
+  when the line is idle again. A node sleeps until its next interrupt
+  between main loop passes, as with __WFI().
+
+  Returns 0 when every request got its reply.
+  */
+#define _XOPEN_SOURCE 600
+#define _DEFAULT_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include "host.h"
+#include "link.h"
+#include "hdlc.h"
+#include "crc.h"
+#include "setup.h"
+#include <termios.h>				// after the device headers, it has CR1 and the like
+
+#define BUS_NODES_MAX			247
+#define BUS_ADDR_FIRST		0x02
+#define BUS_LOG						4096					// characters of one transaction
+#define BUS_DE_MAX				64						// driver enable intervals of one transaction
+#define BUS_MASTER				(-1)					// sender of master characters
+#define BUS_BOOT_US				20000					// nodes boot before the first request
+#define CMD_ID						0x38
+#define CMD_Baud					0x3c
+
+uint8_t host_node_address;
+
+/* Character on the wire, also the message format between the processes */
+typedef struct
+{
+	uint64_t	t;									// start bit
+	uint32_t	baud;
+	uint16_t	word;
+	uint8_t		bits;
+	uint8_t		err;								// HOST_UART_ERR_xxx
+} bus_char_t;
+
+typedef struct
+{
+	uint64_t	t;
+	uint32_t	on;
+} bus_de_t;
+
+/* Master to node: characters, then run until */
+typedef struct
+{
+	uint64_t	until;
+	uint32_t	n;
+} bus_step_t;
+
+/* Node to master: characters sent and driver enable changes */
+typedef struct
+{
+	uint32_t	n;
+	uint32_t	nde;
+} bus_report_t;
+
+typedef struct
+{
+	int				fd;
+	pid_t			pid;
+	uint8_t		addr;
+	uint32_t	replies, lost;
+	uint64_t	lat_sum, lat_max;
+} bus_node_t;
+
+/* Character of the running transaction */
+typedef struct
+{
+	bus_char_t	c;
+	int16_t			sender;							// node index or BUS_MASTER
+	uint8_t			done;								// ended, collision settled
+	uint8_t			sent;								// handed to the lockstep nodes
+	uint8_t			seen;								// taken by the master
+} bus_entry_t;
+
+typedef struct
+{
+	int16_t		sender;
+	uint64_t	on, off;						// off is UINT64_MAX while driven
+} bus_drive_t;
+
+static bus_node_t		nodes[BUS_NODES_MAX];
+static uint16_t			nnodes = 8;
+static uint32_t			bus_baud = SETUP_BAUDRATE;
+static uint32_t			turnaround_us = 100;
+static uint32_t			timeout_ms = 50;
+static uint32_t			steps = 8;
+static uint8_t			verbose;
+
+static bus_entry_t	bus_log[BUS_LOG];
+static uint16_t			bus_len;
+static bus_drive_t	bus_drive[BUS_DE_MAX];
+static uint16_t			bus_ndrive;
+static uint64_t			bus_now;							// all nodes have run up to here
+static uint64_t			bus_free;							// line idle, last stop bit or DE release
+static uint32_t			bus_collisions;
+static uint32_t			bus_unexpected;				// characters from nodes that were not asked
+
+static volatile sig_atomic_t bus_stop;
+
+
+/* Helpers -------------------------------------------------------------------*/
+
+static uint64_t bus_char_us(uint8_t bits, uint32_t baud)
+{
+	return ((bits + 2) * 1000000ULL + baud - 1) / baud;
+}
+
+static uint64_t bus_char_end(const bus_char_t *c)
+{
+	return c->t + bus_char_us(c->bits, c->baud);
+}
+
+static void bus_io(int fd, void *buf, size_t len, int wr)
+{
+	uint8_t *p = buf;
+	ssize_t n;
+
+	while (len > 0)
+	{
+		n = wr ? write(fd, p, len) : read(fd, p, len);
+		if ((n < 0) && (errno == EINTR))
+			continue;
+		if (n <= 0)
+		{
+			if (wr || (n < 0))
+				perror("rs485_bus");
+			_exit(wr ? 1 : 0);      // node: master closed the wire
+		}
+		p += n;
+		len -= n;
+	}
+}
+
+
+/* Node process --------------------------------------------------------------*/
+
+static bus_char_t	node_tx[BUS_LOG];
+static bus_de_t		node_de[BUS_DE_MAX];
+static uint32_t		node_ntx, node_nde;
+
+static void node_tx_char(uint64_t t_us, uint16_t word, uint8_t bits, uint32_t baud)
+{
+	if (node_ntx < BUS_LOG)
+	{
+		node_tx[node_ntx].t = t_us;
+		node_tx[node_ntx].word = word;
+		node_tx[node_ntx].bits = bits;
+		node_tx[node_ntx].baud = baud;
+		node_tx[node_ntx++].err = HOST_UART_ERR_NONE;
+	}
+}
+
+static void node_de_change(uint64_t t_us, uint8_t on)
+{
+	if (node_nde < BUS_DE_MAX)
+	{
+		node_de[node_nde].t = t_us;
+		node_de[node_nde++].on = on;
+	}
+}
+
+static const host_uart_hooks_t node_hooks = { node_tx_char, node_de_change };
+
+static void node_run(int fd, uint8_t addr)
+{
+	bus_step_t step;
+	bus_report_t rep;
+	bus_char_t c;
+	uint64_t t;
+	uint32_t i;
+
+	host_node_address = addr;
+	board_init();
+	host_uart_set_hooks(&node_hooks);
+	board_start();
+	for (;;)
+	{
+		bus_io(fd, &step, sizeof(step), 0);
+		for (i=0; i<step.n; i++)
+		{
+			bus_io(fd, &c, sizeof(c), 0);
+			host_uart_rx_char(c.t, c.word, c.bits, c.baud, c.err);
+		}
+		node_ntx = node_nde = 0;
+		while (host_time_us() < step.until)
+		{
+			board_loop();
+			t = host_next_event();      // sleep until the next interrupt
+			if (t > host_time_us())
+				host_advance_to((t < step.until) ? t : step.until);
+		}
+		rep.n = node_ntx;
+		rep.nde = node_nde;
+		bus_io(fd, &rep, sizeof(rep), 1);
+		bus_io(fd, node_tx, node_ntx * sizeof(bus_char_t), 1);
+		bus_io(fd, node_de, node_nde * sizeof(bus_de_t), 1);
+	}
+}
+
+static void bus_spawn(void)
+{
+	int sv[2];
+	uint16_t i, k;
+
+	for (i=0; i<nnodes; i++)
+	{
+		if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0)
+		{
+			perror("socketpair");
+			exit(2);
+		}
+		nodes[i].pid = fork();
+		if (nodes[i].pid == 0)
+		{
+			for (k=0; k<i; k++)       // master ends of the older nodes
+				close(nodes[k].fd);
+			close(sv[0]);
+			signal(SIGINT, SIG_IGN);  // Ctrl-C stops the bus, the nodes follow on EOF
+			node_run(sv[1], nodes[i].addr);
+		}
+		close(sv[1]);
+		nodes[i].fd = sv[0];
+	}
+}
+
+static void bus_shutdown(void)
+{
+	uint16_t i;
+
+	for (i=0; i<nnodes; i++)
+		close(nodes[i].fd);
+	for (i=0; i<nnodes; i++)
+		waitpid(nodes[i].pid, NULL, 0);
+}
+
+
+/* Wire ----------------------------------------------------------------------*/
+
+static void bus_add_char(const bus_char_t *c, int16_t sender)
+{
+	uint16_t i;
+
+	if (bus_len == BUS_LOG)
+		return;
+	for (i=bus_len; (i > 0) && (bus_log[i - 1].c.t > c->t); i--)   // keep start order
+		bus_log[i] = bus_log[i - 1];
+	bus_log[i].c = *c;
+	bus_log[i].sender = sender;
+	bus_log[i].done = 0;
+	bus_log[i].sent = 0;
+	bus_log[i].seen = 0;
+	bus_len++;
+	if (bus_char_end(c) > bus_free)
+		bus_free = bus_char_end(c);
+}
+
+static void bus_add_de(const bus_de_t *de, int16_t sender)
+{
+	uint16_t i;
+
+	if (de->on)
+	{
+		if (bus_ndrive < BUS_DE_MAX)
+		{
+			bus_drive[bus_ndrive].sender = sender;
+			bus_drive[bus_ndrive].on = de->t;
+			bus_drive[bus_ndrive++].off = UINT64_MAX;
+		}
+		return;
+	}
+	for (i=0; i<bus_ndrive; i++)
+		if ((bus_drive[i].sender == sender) && (bus_drive[i].off == UINT64_MAX))
+			bus_drive[i].off = de->t;
+	if (de->t > bus_free)
+		bus_free = de->t;
+}
+
+static uint8_t bus_driven(void)
+{
+	uint16_t i;
+
+	for (i=0; i<bus_ndrive; i++)
+		if (bus_drive[i].off == UINT64_MAX)
+			return 1;
+	return 0;
+}
+
+
+/* Character e meets another sender on the line */
+static uint8_t bus_collides(const bus_entry_t *e)
+{
+	uint64_t end = bus_char_end(&e->c);
+	uint16_t i;
+
+	for (i=0; i<bus_len; i++)
+		if ((bus_log[i].sender != e->sender) && (bus_log[i].c.t < end) && (bus_char_end(&bus_log[i].c) > e->c.t))
+			return 1;
+	for (i=0; i<bus_ndrive; i++)
+		if ((bus_drive[i].sender != e->sender) && (bus_drive[i].on < end) && (bus_drive[i].off > e->c.t))
+			return 1;
+	return 0;
+}
+
+/* Characters that ended by t are final, colliding ones are broken */
+static void bus_settle(uint64_t t)
+{
+	bus_entry_t *e;
+	uint16_t i;
+
+	for (i=0; i<bus_len; i++)
+	{
+		e = &bus_log[i];
+		if (e->done || (bus_char_end(&e->c) > t))
+			continue;
+		e->done = 1;
+		if (bus_collides(e))
+		{
+			e->c.err |= HOST_UART_ERR_FE;
+			e->c.word ^= 0x55;
+			bus_collisions++;
+		}
+	}
+}
+
+/* Hand settled characters to node k and let it run until */
+static void bus_send_step(uint16_t k, uint64_t until, uint8_t all)
+{
+	bus_step_t step;
+	uint16_t i;
+
+	step.until = until;
+	step.n = 0;
+	for (i=0; i<bus_len; i++)
+		if (bus_log[i].done && (all || !bus_log[i].sent) && (bus_log[i].sender != k))
+			step.n++;
+	bus_io(nodes[k].fd, &step, sizeof(step), 1);
+	for (i=0; i<bus_len; i++)
+		if (bus_log[i].done && (all || !bus_log[i].sent) && (bus_log[i].sender != k))
+			bus_io(nodes[k].fd, &bus_log[i].c, sizeof(bus_char_t), 1);
+}
+
+/* Characters and DE changes of node k in its last step, returns characters */
+static uint32_t bus_take_report(uint16_t k)
+{
+	bus_report_t rep;
+	bus_char_t c;
+	bus_de_t de;
+	uint32_t i;
+
+	bus_io(nodes[k].fd, &rep, sizeof(rep), 0);
+	for (i=0; i<rep.n; i++)
+	{
+		bus_io(nodes[k].fd, &c, sizeof(c), 0);
+		bus_add_char(&c, k);
+	}
+	for (i=0; i<rep.nde; i++)
+	{
+		bus_io(nodes[k].fd, &de, sizeof(de), 0);
+		bus_add_de(&de, k);
+	}
+	return rep.n;
+}
+
+/* One lockstep step of the nodes in run[], up to until */
+static void bus_step(const uint8_t *run, uint64_t until)
+{
+	uint16_t i;
+
+	bus_settle(bus_now);
+	for (i=0; i<nnodes; i++)
+		if (run[i])
+			bus_send_step(i, until, 0);
+	for (i=0; i<bus_len; i++)
+		if (bus_log[i].done)
+			bus_log[i].sent = 1;
+	for (i=0; i<nnodes; i++)
+		if (run[i])
+			bus_take_report(i);
+	bus_now = until;
+}
+
+/* Line idle, bring the listening nodes up to bus_now and start a new log */
+static void bus_sync(const uint8_t *run)
+{
+	uint16_t i;
+
+	bus_settle(UINT64_MAX);
+	for (i=0; i<nnodes; i++)
+		bus_send_step(i, bus_now, !run[i]);
+	for (i=0; i<nnodes; i++)
+		if (bus_take_report(i) && !run[i])
+			bus_unexpected++;
+	bus_len = 0;
+	bus_ndrive = 0;
+}
+
+/* Everybody listens for ms */
+static void bus_idle(uint32_t ms)
+{
+	static const uint8_t none[BUS_NODES_MAX];
+
+	bus_now += 1000ULL * ms;
+	bus_sync(none);
+}
+
+
+/* Master --------------------------------------------------------------------*/
+
+typedef struct
+{
+	uint8_t		frame[HDLC_TX_MTU + 8];
+	uint16_t	n;
+	uint8_t		esc, bad;
+	uint64_t	tstart;								// first character, 0 before
+	uint64_t	tframe;								// start of the last complete frame
+} bus_rx_t;
+
+/* Next character off the wire, returns frame length without CRC when complete */
+static int bus_rx(bus_rx_t *rx, const bus_char_t *c)
+{
+	uint8_t data = (uint8_t)c->word;
+	int n;
+
+	if (c->err)
+		rx->bad = 1;
+	if (rx->tstart == 0)            // opening flag, or first byte after a shared flag
+		rx->tstart = c->t;
+	if (data == HDLC_FLAG_SOF)
+	{
+		if (rx->n == 0)
+			return -1;
+		n = (!rx->bad && (rx->n >= 5) && (crc16(rx->frame, rx->n) == CRC16_RESIDUE)) ? rx->n - 2 : -1;
+		rx->tframe = rx->tstart;
+		rx->tstart = 0;
+		rx->n = 0;
+		rx->esc = 0;
+		rx->bad = 0;
+		return n;
+	}
+	if (data == HDLC_CONTROL_ESCAPE)
+	{
+		rx->esc = 1;
+		return -1;
+	}
+	if (rx->n < sizeof(rx->frame))
+		rx->frame[rx->n++] = rx->esc ? (data ^ HDLC_ESCAPE_BIT) : data;
+	rx->esc = 0;
+	return -1;
+}
+
+/*
+ * Request to dest and its reply. Nodes with that address run in lockstep
+ * until the reply is in and the line is free again, or until the timeout.
+ * Returns reply length, -1 when lost, latency from the request end to the
+ * reply start in lat.
+ */
+static int bus_transact(uint8_t dest, const uint8_t *payload, uint16_t len, uint32_t baud, uint64_t *lat)
+{
+	uint8_t run[BUS_NODES_MAX];
+	uint8_t wire[2*HDLC_TX_MTU + 16];
+	uint16_t i, n, nrun = 0;
+	uint64_t t0, tend, deadline, step;
+	bus_char_t c;
+	bus_rx_t rx;
+	int reply = -1, r;
+
+	t0 = bus_free + turnaround_us;
+	if (t0 < bus_now)
+		t0 = bus_now;
+	n = link_wire(wire, LINK_MASTER_ADDR, dest, payload, len);
+	for (i=0; i<n; i++)
+	{
+		c.t = t0 + i * bus_char_us(8, baud);
+		c.word = wire[i];
+		c.bits = 8;
+		c.baud = baud;
+		c.err = HOST_UART_ERR_NONE;
+		bus_add_char(&c, BUS_MASTER);
+	}
+	tend = t0 + n * bus_char_us(8, baud);
+
+	for (i=0; i<nnodes; i++)
+		nrun += (run[i] = (nodes[i].addr == dest));
+	if (nrun == 0)          // broadcast or nobody there, wait for the line only
+	{
+		bus_now = tend;
+		bus_sync(run);
+		return -1;
+	}
+
+	memset(&rx, 0, sizeof(rx));
+	step = (bus_char_us(8, baud) + steps - 1) / steps;
+	deadline = tend + 1000ULL * timeout_ms;
+	while (bus_now < deadline)
+	{
+		bus_step(run, bus_now + step);
+		for (i=0; i<bus_len; i++)
+		{
+			if (!bus_log[i].done || bus_log[i].seen || (bus_log[i].sender == BUS_MASTER))
+				continue;
+			bus_log[i].seen = 1;
+			r = bus_rx(&rx, &bus_log[i].c);
+			if ((r >= 4) && (reply < 0) && (rx.frame[0] == dest) && (rx.frame[1] == LINK_MASTER_ADDR) &&
+			    (rx.frame[3] == payload[0]))
+			{
+				reply = r;
+				*lat = rx.tframe - tend;
+			}
+		}
+		if ((reply >= 0) && !bus_driven() && (bus_now >= bus_free))
+			break;
+	}
+	bus_sync(run);
+	return reply;
+}
+
+static void bus_print_node(const bus_node_t *node)
+{
+	printf("  node 0x%02x  %5u replies  %3u lost", node->addr, node->replies, node->lost);
+	if (node->replies)
+		printf("  latency %7.3f ms avg  %7.3f ms max", node->lat_sum / 1000.0 / node->replies, node->lat_max / 1000.0);
+	printf("\n");
+}
+
+static int bus_sweeps(uint32_t sweeps)
+{
+	uint8_t req = CMD_ID;
+	uint64_t t0, lat, lat_min = UINT64_MAX, lat_max = 0, lat_sum = 0;
+	uint32_t s, replies = 0, lost = 0, sweep_lost, collisions;
+	uint16_t i;
+
+	printf("%u nodes at %u Bd, turnaround %u us, DE %u/%u of 16 bit\n", nnodes, bus_baud, turnaround_us,
+	       SETUP_DE_ASSERT, SETUP_DE_DEASSERT);
+	for (s=0; s<sweeps; s++)
+	{
+		t0 = bus_now;
+		sweep_lost = 0;
+		collisions = bus_collisions;
+		for (i=0; i<nnodes; i++)
+		{
+			if (bus_transact(nodes[i].addr, &req, 1, bus_baud, &lat) < 0)
+			{
+				nodes[i].lost++;
+				sweep_lost++;
+				continue;
+			}
+			nodes[i].replies++;
+			nodes[i].lat_sum += lat;
+			if (lat > nodes[i].lat_max)
+				nodes[i].lat_max = lat;
+			if (lat < lat_min)
+				lat_min = lat;
+			if (lat > lat_max)
+				lat_max = lat;
+			lat_sum += lat;
+			replies++;
+		}
+		lost += sweep_lost;
+		printf("sweep %u: %9.3f ms  %u replies  %u lost  %u collisions\n", s + 1, (bus_now - t0) / 1000.0,
+		       nnodes - sweep_lost, sweep_lost, bus_collisions - collisions);
+	}
+	if (replies)
+		printf("latency %.3f ms min  %.3f ms avg  %.3f ms max, request end to reply start\n",
+		       lat_min / 1000.0, lat_sum / 1000.0 / replies, lat_max / 1000.0);
+	printf("frames lost %u of %u (%.2f %%)\n", lost, sweeps * nnodes, 100.0 * lost / (sweeps * nnodes));
+	if (bus_unexpected)
+		printf("%u characters from nodes that were not asked\n", bus_unexpected);
+	if (verbose)
+		for (i=0; i<nnodes; i++)
+			bus_print_node(&nodes[i]);
+	return lost ? 1 : 0;
+}
+
+
+/* pty -----------------------------------------------------------------------*/
+
+static void bus_signal(int sig)
+{
+	bus_stop = 1;
+}
+
+static int bus_pty(void)
+{
+	uint8_t run[BUS_NODES_MAX];
+	uint8_t buf[256];
+	uint64_t step, line, wall0, lag_max = 0;
+	struct timespec ts;
+	struct termios tio;
+	bus_char_t c;
+	ssize_t n, k;
+	uint16_t i, j;
+	int fd, slave;
+
+	fd = posix_openpt(O_RDWR | O_NOCTTY);
+	if ((fd < 0) || (grantpt(fd) < 0) || (unlockpt(fd) < 0))
+	{
+		perror("pty");
+		return 2;
+	}
+	slave = open(ptsname(fd), O_RDWR | O_NOCTTY);    // raw, and open while no master is attached
+	if ((slave >= 0) && (tcgetattr(slave, &tio) == 0))
+	{
+		cfmakeraw(&tio);
+		tcsetattr(slave, TCSANOW, &tio);
+	}
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	signal(SIGINT, bus_signal);
+	signal(SIGTERM, bus_signal);
+	printf("%u nodes at %u Bd on %s\n", nnodes, bus_baud, ptsname(fd));
+	fflush(stdout);
+
+	memset(run, 1, sizeof(run));
+	step = (bus_char_us(8, bus_baud) + steps - 1) / steps;
+	line = bus_now;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	wall0 = ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000 - bus_now;
+	while (!bus_stop)
+	{
+		n = read(fd, buf, sizeof(buf));
+		for (k=0; k<n; k++)
+		{
+			c.t = (line > bus_now) ? line : bus_now;
+			c.word = buf[k];
+			c.bits = 8;
+			c.baud = bus_baud;
+			c.err = HOST_UART_ERR_NONE;
+			bus_add_char(&c, BUS_MASTER);
+			line = bus_char_end(&c);
+		}
+		bus_step(run, bus_now + step);
+
+		// node characters to the master, then drop what everybody has
+		for (i=0, j=0; i<bus_len; i++)
+		{
+			if (bus_log[i].done && !bus_log[i].seen && (bus_log[i].sender != BUS_MASTER))
+			{
+				buf[0] = (uint8_t)bus_log[i].c.word;
+				if (write(fd, buf, 1) < 0)
+				{
+					// no master attached, the character is dropped
+				}
+				bus_log[i].seen = 1;
+			}
+			if (!bus_log[i].done || !bus_log[i].sent || (bus_char_end(&bus_log[i].c) + 4 * step > bus_now))
+				bus_log[j++] = bus_log[i];
+		}
+		bus_len = j;
+		for (i=0, j=0; i<bus_ndrive; i++)
+			if ((bus_drive[i].off == UINT64_MAX) || (bus_drive[i].off + 4 * step > bus_now))
+				bus_drive[j++] = bus_drive[i];
+		bus_ndrive = j;
+
+		// real time
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		if (bus_now > ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000 - wall0)
+		{
+			ts.tv_sec = 0;
+			ts.tv_nsec = (bus_now - (ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000 - wall0)) * 1000;
+			nanosleep(&ts, NULL);
+		}
+		else if (ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000 - wall0 - bus_now > lag_max)
+			lag_max = ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000 - wall0 - bus_now;
+	}
+	printf("%u collisions, up to %.3f ms behind real time\n", bus_collisions, lag_max / 1000.0);
+	if (slave >= 0)
+		close(slave);
+	close(fd);
+	return 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+	uint8_t req[5] = { CMD_Baud };
+	uint32_t sweeps = 1, baud = SETUP_BAUDRATE;
+	uint8_t dup = 0, pty = 0;
+	uint64_t lat;
+	uint16_t i;
+	int opt, ret;
+
+	while ((opt = getopt(argc, argv, "n:b:s:t:w:q:Dvp")) != -1)
+	{
+		switch (opt)
+		{
+			case 'n': nnodes = strtoul(optarg, NULL, 0); break;
+			case 'b': baud = strtoul(optarg, NULL, 0); break;
+			case 's': sweeps = strtoul(optarg, NULL, 0); break;
+			case 't': turnaround_us = strtoul(optarg, NULL, 0); break;
+			case 'w': timeout_ms = strtoul(optarg, NULL, 0); break;
+			case 'q': steps = strtoul(optarg, NULL, 0); break;
+			case 'D': dup = 1; break;
+			case 'v': verbose = 1; break;
+			case 'p': pty = 1; break;
+			default:
+				fprintf(stderr, "usage: rs485_bus [-n nodes] [-b baud] [-s sweeps] [-t us] [-w ms] [-q steps] [-D] [-v] [-p]\n");
+				return 2;
+		}
+	}
+	if ((nnodes < 1) || (nnodes > BUS_NODES_MAX) || (steps < 1) || (baud < SETUP_BAUDRATE) || (baud > SETUP_BAUD_MAX))
+	{
+		fprintf(stderr, "rs485_bus: 1..%u nodes, rate %u..%u\n", BUS_NODES_MAX, SETUP_BAUDRATE, SETUP_BAUD_MAX);
+		return 2;
+	}
+	for (i=0; i<nnodes; i++)
+		nodes[i].addr = BUS_ADDR_FIRST + i;
+	if (dup && (nnodes > 1))
+		nodes[nnodes - 1].addr = nodes[0].addr;
+
+	bus_spawn();
+	bus_idle(BUS_BOOT_US / 1000);
+	if (baud != SETUP_BAUDRATE)     // all nodes at once, no reply to a broadcast
+	{
+		req[1] = baud & 0xff;
+		req[2] = (baud >> 8) & 0xff;
+		req[3] = (baud >> 16) & 0xff;
+		req[4] = (baud >> 24) & 0xff;
+		bus_transact(HDLC_BROADCAST_ADDR, req, sizeof(req), SETUP_BAUDRATE, &lat);
+		bus_idle(5);
+		bus_baud = baud;
+	}
+
+	ret = pty ? bus_pty() : bus_sweeps(sweeps);
+	bus_shutdown();
+	return ret;
+}
@@ -0,0 +1,62 @@
+/**
+  ******************************************************************************
+  * File Name          : MS5637_ref.c
+  * Description        : Floating point MS5637 compensation before integer path
+  ******************************************************************************
+  *
+  * Copyright (c) 2016 S54MTB
+  * Licensed under Apache License 2.0
+  * http://www.apache.org/licenses/LICENSE-2.0.html
+  *
+  ******************************************************************************
+
+  MS5637_Calculate() as it was before MS5637_Calculate_int(), reference
+  for the equivalence test. Only change: T2, OFFSET2 and SENS2 start at 0,
+  the original left them unset at exactly 20.00 degC.
+  */
+#include <math.h>
+#include "stm32f0xx_hal.h"
+
+HAL_StatusTypeDef MS5637_Calculate_ref(uint16_t *C, uint32_t D1, uint32_t D2, double *Temperature, double *Pressure)
+{
+	double dT, OFFSET, SENS, T2 = 0, OFFSET2 = 0, SENS2 = 0;  // Raw data for calculation
+
+	dT = D2 - C[5]*pow(2,8);    // Calculate dT, OFS and SENS, datasheet page 6
+  OFFSET = C[2]*pow(2, 17) + dT*C[4]/pow(2,6);
+  SENS = C[1]*pow(2,16) + dT*C[3]/pow(2,7);
+ 
+  *Temperature = (2000 + ((dT*C[6]))/pow(2, 23))/100;  // MS5637 temp has 0.01 degC "unit" - convert to 1 degC
+//-------------------------------------------
+// Calculate second order corrections
+	if(*Temperature > 20.0f) 
+	{
+		T2 = 5*dT*dT/pow(2, 38); // correction above 20 degC
+		OFFSET2 = 0;
+		SENS2 = 0;
+	}
+	if(*Temperature < 20.0f)   // correction below 20 degC
+	{
+		T2      = 3*dT*dT/pow(2, 33); 
+		OFFSET2 = 61*(100 * *Temperature - 2000)*(100 * *Temperature - 2000)/16;
+		SENS2   = 29*(100 * *Temperature - 2000)*(100 * *Temperature - 2000)/16;
+	} 
+	if(*Temperature < -15.0f)     // correction below -15 degC
+	{
+		OFFSET2 = OFFSET2 + 17*(100 * *Temperature + 1500)*(100 * *Temperature + 1500);
+		SENS2 = SENS2 + 9*(100 * *Temperature + 1500)*(100 * *Temperature + 1500);
+  }
+ // End of second order corrections
+ //-------------------------------------------
+	*Temperature = *Temperature - T2/100;
+	OFFSET = OFFSET - OFFSET2;
+	SENS = SENS - SENS2;
+	// Pressure in mbar or hPa
+	*Pressure = (((D1*SENS)/pow(2, 21) - OFFSET)/pow(2, 15))/100; 
+
+	if ( (*Temperature < -40.0f) | (*Temperature > 85.0f) |
+		   (*Pressure < 10.0f) | (*Pressure > 2000.0f))
+	return 
+		HAL_ERROR;
+	else	
+	  return HAL_OK;
+}
@@ -0,0 +1,130 @@
+/**
+  ******************************************************************************
+  * File Name          : hdc1080_sim.c
+  * Description        : HDC1080 model on the virtual I2C bus
+  ******************************************************************************
+  *
+  * Copyright (c) 2016 S54MTB
+  * Licensed under Apache License 2.0
+  * http://www.apache.org/licenses/LICENSE-2.0.html
+  *
+  ******************************************************************************
+
+  Register pointer, configuration, serial and ID registers of the HDC1080
+  datasheet. Writing pointer 0x00 or 0x01 triggers a conversion, in
+  acquisition mode (config bit 12) temperature and humidity one after the
+  other. Result reads are NACKed until the conversion has ended, typical
+  times from the datasheet plus extra_us for a slow part. A read after the
+  conversion returns both results in acquisition mode, the register at the
+  pointer otherwise.
+  */
+#include <string.h>
+#include "sensor_sim.h"
+
+#define SIM_HDC1080_MANUFACTURER	0x5449
+#define SIM_HDC1080_DEVICE				0x1050
+#define SIM_HDC1080_CONFIG_RESET	0x1000
+#define SIM_HDC1080_CONFIG_RW			0x3700			// heater, mode, resolutions
+
+/* Typical conversion times in us */
+static const uint16_t sim_hdc1080_t_us[2] = { 6350, 3650 };					// 14, 11 bit
+static const uint16_t sim_hdc1080_rh_us[4] = { 6500, 3850, 2500, 2500 };	// 14, 11, 8 bit
+
+
+uint32_t sim_hdc1080_conv_us(uint16_t config)
+{
+	uint32_t t = sim_hdc1080_t_us[(config >> 10) & 1];
+	uint32_t rh = sim_hdc1080_rh_us[(config >> 8) & 3];
+
+	return (config & (1 << 12)) ? t + rh : t;
+}
+
+
+static int sim_hdc1080_start(host_i2c_dev_t *dev, uint8_t read)
+{
+	sim_hdc1080_t *sim = (sim_hdc1080_t *)dev;
+
+	if (read && sim->converting)
+	{
+		if (host_time_us() < sim->tready)
+		{
+			sim->nacks++;
+			return 1;
+		}
+		sim->converting = 0;
+		sim->ready = 1;
+	}
+	return 0;
+}
+
+static void sim_hdc1080_write(host_i2c_dev_t *dev, const uint8_t *buf, uint16_t len)
+{
+	sim_hdc1080_t *sim = (sim_hdc1080_t *)dev;
+
+	sim->pointer = buf[0];
+	if ((sim->pointer == 0x02) && (len >= 3))
+	{
+		if (buf[1] & 0x80)                            // soft reset
+			sim->config = SIM_HDC1080_CONFIG_RESET;
+		else
+			sim->config = (sim->config & ~SIM_HDC1080_CONFIG_RW) | ((buf[1] << 8) & SIM_HDC1080_CONFIG_RW);
+	}
+	else if ((sim->pointer <= 0x01) && (len == 1))   // trigger
+	{
+		sim->converting = 1;
+		sim->ready = 0;
+		sim->tready = host_time_us() + sim_hdc1080_conv_us(sim->config) + sim->extra_us;
+		sim->conversions++;
+	}
+}
+
+static uint16_t sim_hdc1080_reg(sim_hdc1080_t *sim, uint8_t reg)
+{
+	switch (reg)
+	{
+		case 0x00: return sim->temperature;
+		case 0x01: return sim->humidity;
+		case 0x02: return (sim->config & ~(1 << 11)) | (sim->bat ? (1 << 11) : 0);
+		case 0xfb: return sim->serial[0];
+		case 0xfc: return sim->serial[1];
+		case 0xfd: return sim->serial[2] & 0xff80;
+		case 0xfe: return SIM_HDC1080_MANUFACTURER;
+		case 0xff: return SIM_HDC1080_DEVICE;
+		default:   return 0xffff;
+	}
+}
+
+static void sim_hdc1080_read(host_i2c_dev_t *dev, uint8_t *buf, uint16_t len)
+{
+	sim_hdc1080_t *sim = (sim_hdc1080_t *)dev;
+	uint16_t v[2];
+	uint8_t i, n = 1;
+
+	sim->reads++;
+	v[0] = sim_hdc1080_reg(sim, sim->pointer);
+	if (sim->ready && (sim->pointer == 0x00) && (sim->config & (1 << 12)))
+	{
+		v[1] = sim->humidity;
+		n = 2;
+	}
+	sim->ready = 0;
+	for (i=0; (i<2*n) && (i<len); i++)
+		buf[i] = (uint8_t)(v[i >> 1] >> ((i & 1) ? 0 : 8));
+}
+
+
+void sim_hdc1080_init(sim_hdc1080_t *sim)
+{
+	memset(sim, 0, sizeof(*sim));
+	sim->config = SIM_HDC1080_CONFIG_RESET;
+	sim->serial[0] = 0x0123;
+	sim->serial[1] = 0x4567;
+	sim->serial[2] = 0x8980;
+	sim->temperature = 0x6666;                       // 25.99 C
+	sim->humidity = 0x8000;                          // 50.00 %RH
+	sim->dev.addr = SIM_HDC1080_ADDR;
+	sim->dev.start = sim_hdc1080_start;
+	sim->dev.write = sim_hdc1080_write;
+	sim->dev.read = sim_hdc1080_read;
+	host_i2c_attach(&sim->dev);
+}
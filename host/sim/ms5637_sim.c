@@ -0,0 +1,129 @@
+/**
+  ******************************************************************************
+  * File Name          : ms5637_sim.c
+  * Description        : MS5637 model on the virtual I2C bus
+  ******************************************************************************
+  *
+  * Copyright (c) 2016 S54MTB
+  * Licensed under Apache License 2.0
+  * http://www.apache.org/licenses/LICENSE-2.0.html
+  *
+  ******************************************************************************
+
+  Commands of the MS5637-02BA03 datasheet: reset, PROM read, D1 and D2
+  conversion at OSR 256..8192 and ADC read. The part does not ACK its
+  address while the PROM reloads after reset. An ADC read during a
+  conversion, or a second read of the same result, returns 0.
+  */
+#include <string.h>
+#include "sensor_sim.h"
+
+/* Datasheet maximum conversion times in us, OSR 256 .. 8192 */
+static const uint16_t sim_ms5637_conv[6] = { 540, 1060, 2080, 4130, 8220, 16440 };
+
+/* C1..C6 and raw values of the datasheet example, 20.00 C and 1100.02 mbar */
+static const uint16_t sim_ms5637_C[8] = { 0, 46372, 43981, 29059, 27842, 31553, 28165, 0 };
+#define SIM_MS5637_D1		6465444
+#define SIM_MS5637_D2		8077636
+
+
+/* CRC4 of application note AN520, over C0 without its CRC bits and C1..C7 */
+static uint8_t sim_ms5637_crc4(const uint16_t *prom)
+{
+	uint16_t w[8], rem = 0;
+	uint8_t i, bit;
+
+	memcpy(w, prom, sizeof(w));
+	w[0] &= 0x0fff;
+	w[7] = 0;
+	for (i=0; i<16; i++)
+	{
+		rem ^= (i & 1) ? (w[i >> 1] & 0xff) : (w[i >> 1] >> 8);
+		for (bit=0; bit<8; bit++)
+			rem = (rem & 0x8000) ? (rem << 1) ^ 0x3000 : (rem << 1);
+	}
+	return (rem >> 12) & 0x0f;
+}
+
+uint32_t sim_ms5637_conv_us(uint8_t osr)
+{
+	if ((osr > 0x0a) || (osr & 1))
+		return 0;
+	return sim_ms5637_conv[osr >> 1];
+}
+
+
+static int sim_ms5637_start(host_i2c_dev_t *dev, uint8_t read)
+{
+	sim_ms5637_t *sim = (sim_ms5637_t *)dev;
+
+	if (!sim->converting && (host_time_us() < sim->tready))
+	{
+		sim->nacks++;
+		return 1;
+	}
+	return 0;
+}
+
+static void sim_ms5637_write(host_i2c_dev_t *dev, const uint8_t *buf, uint16_t len)
+{
+	sim_ms5637_t *sim = (sim_ms5637_t *)dev;
+	uint8_t cmd = buf[0];
+	uint32_t t;
+
+	sim->cmd = cmd;
+	if (cmd == 0x1e)                                  // reset
+	{
+		sim->converting = 0;
+		sim->adc = 0;
+		sim->tready = host_time_us() + SIM_MS5637_RESET_US;
+	}
+	else if (((cmd & 0xe0) == 0x40) && ((t = sim_ms5637_conv_us(cmd & 0x0f)) != 0))
+	{
+		sim->converting = 1;
+		sim->adc = (cmd & 0x10) ? sim->D2 : sim->D1;
+		sim->tready = host_time_us() + t;
+		sim->conversions++;
+	}
+}
+
+static void sim_ms5637_read(host_i2c_dev_t *dev, uint8_t *buf, uint16_t len)
+{
+	sim_ms5637_t *sim = (sim_ms5637_t *)dev;
+	uint32_t v = 0;
+	uint8_t i;
+
+	if (sim->cmd == 0x00)                             // ADC read, 24 bit
+	{
+		sim->adc_reads++;
+		if (sim->converting && (host_time_us() >= sim->tready))
+			v = sim->adc;
+		else
+			sim->adc_early++;
+		sim->converting = 0;
+		sim->adc = 0;
+		for (i=0; (i<3) && (i<len); i++)
+			buf[i] = (uint8_t)(v >> (16 - 8 * i));
+	}
+	else if ((sim->cmd & 0xf1) == 0xa0)               // PROM read, 16 bit
+	{
+		v = sim->prom[(sim->cmd >> 1) & 7];
+		for (i=0; (i<2) && (i<len); i++)
+			buf[i] = (uint8_t)(v >> (8 - 8 * i));
+	}
+}
+
+
+void sim_ms5637_init(sim_ms5637_t *sim, const uint16_t *C)
+{
+	memset(sim, 0, sizeof(*sim));
+	memcpy(sim->prom, (C != NULL) ? C : sim_ms5637_C, sizeof(sim->prom));
+	sim->prom[0] = (sim->prom[0] & 0x0fff) | (sim_ms5637_crc4(sim->prom) << 12);
+	sim->D1 = SIM_MS5637_D1;
+	sim->D2 = SIM_MS5637_D2;
+	sim->dev.addr = SIM_MS5637_ADDR;
+	sim->dev.start = sim_ms5637_start;
+	sim->dev.write = sim_ms5637_write;
+	sim->dev.read = sim_ms5637_read;
+	host_i2c_attach(&sim->dev);
+}
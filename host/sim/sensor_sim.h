@@ -0,0 +1,74 @@
+/**
+  ******************************************************************************
+  * File Name          : sensor_sim.h
+  * Description        : Register level MS5637 and HDC1080 models for host builds
+  ******************************************************************************
+  *
+  * Copyright (c) 2016 S54MTB
+  * Licensed under Apache License 2.0
+  * http://www.apache.org/licenses/LICENSE-2.0.html
+  *
+  ******************************************************************************
+
+  The models sit on the virtual I2C bus of stub/hal_i2c.c and answer the
+  commands of the datasheets on the virtual clock. Conversions take the
+  datasheet time from the STOP of the command, reads that come too early
+  get what the part returns then: zero from the MS5637 ADC, a NACK from
+  the HDC1080. Counters let tests and benches see how the drivers use the
+  bus.
+  */
+#ifndef __SENSOR_SIM_H__
+#define __SENSOR_SIM_H__
+
+#include "host.h"
+
+#define SIM_MS5637_ADDR				0x76
+#define SIM_HDC1080_ADDR			0x40
+#define SIM_MS5637_RESET_US		2800				// PROM reload after reset
+
+
+/* MS5637 --------------------------------------------------------------------*/
+typedef struct
+{
+	host_i2c_dev_t	dev;							// first, callbacks cast back to the model
+	uint16_t	prom[8];								// C0..C7, CRC4 in C0 bits 15..12
+	uint32_t	D1, D2;									// raw pressure and temperature results
+	uint32_t	adc;										// ADC register, read once
+	uint8_t		cmd;										// last command byte
+	uint8_t		converting;							// D1/D2 conversion running
+	uint64_t	tready;									// end of conversion or PROM reload, us
+	/* bus usage */
+	uint32_t	conversions;
+	uint32_t	adc_reads;
+	uint32_t	adc_early;							// ADC reads before conversion end, got 0
+	uint32_t	nacks;
+} sim_ms5637_t;
+
+/* C1..C6 as in the datasheet example when C is NULL, CRC4 is added */
+void sim_ms5637_init(sim_ms5637_t *sim, const uint16_t *C);
+uint32_t sim_ms5637_conv_us(uint8_t osr);
+
+
+/* HDC1080 -------------------------------------------------------------------*/
+typedef struct
+{
+	host_i2c_dev_t	dev;
+	uint8_t		pointer;								// register pointer
+	uint16_t	config;
+	uint16_t	serial[3];							// 0xFB..0xFD
+	uint16_t	temperature, humidity;	// raw results of the next conversion
+	uint8_t		bat;										// supply below 2,8 V
+	uint32_t	extra_us;								// conversion takes this much longer than typical
+	uint8_t		converting;
+	uint8_t		ready;									// results of a conversion not read yet
+	uint64_t	tready;
+	/* bus usage */
+	uint32_t	conversions;
+	uint32_t	nacks;									// result reads NACKed while converting
+	uint32_t	reads;
+} sim_hdc1080_t;
+
+void sim_hdc1080_init(sim_hdc1080_t *sim);
+uint32_t sim_hdc1080_conv_us(uint16_t config);
+
+#endif
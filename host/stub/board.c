@@ -0,0 +1,154 @@
+/**
+  ******************************************************************************
+  * File Name          : board.c
+  * Description        : main.c and stm32f0xx_hal_msp.c for host builds
+  ******************************************************************************
+  *
+  * Copyright (c) 2016 S54MTB
+  * Licensed under Apache License 2.0
+  * http://www.apache.org/licenses/LICENSE-2.0.html
+  *
+  ******************************************************************************
+
+  Same peripheral setup and start sequence as main(), the main loop is
+  split into board_loop() so that host programs can drive the virtual
+  clock and the line between iterations.
+  */
+#include "host.h"
+#include "hdlc.h"
+#include "sampler.h"
+#include "i2c_bus.h"
+#include "serial.h"
+#include "setup.h"
+
+I2C_HandleTypeDef hi2c1;
+UART_HandleTypeDef huart2;
+DMA_HandleTypeDef hdma_usart2_rx;
+DMA_HandleTypeDef hdma_usart2_tx;
+
+
+void HAL_UART_MspInit(UART_HandleTypeDef *huart)
+{
+	if (huart->Instance == USART2)
+	{
+		hdma_usart2_rx.Instance = DMA1_Channel5;
+		hdma_usart2_rx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+		hdma_usart2_rx.Init.PeriphInc = DMA_PINC_DISABLE;
+		hdma_usart2_rx.Init.MemInc = DMA_MINC_ENABLE;
+		hdma_usart2_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+		hdma_usart2_rx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+		hdma_usart2_rx.Init.Mode = DMA_CIRCULAR;
+		hdma_usart2_rx.Init.Priority = DMA_PRIORITY_HIGH;
+		HAL_DMA_Init(&hdma_usart2_rx);
+		__HAL_LINKDMA(huart, hdmarx, hdma_usart2_rx);
+
+		hdma_usart2_tx.Instance = DMA1_Channel4;
+		hdma_usart2_tx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+		hdma_usart2_tx.Init.PeriphInc = DMA_PINC_DISABLE;
+		hdma_usart2_tx.Init.MemInc = DMA_MINC_ENABLE;
+		hdma_usart2_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+		hdma_usart2_tx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+		hdma_usart2_tx.Init.Mode = DMA_NORMAL;
+		hdma_usart2_tx.Init.Priority = DMA_PRIORITY_LOW;
+		HAL_DMA_Init(&hdma_usart2_tx);
+		__HAL_LINKDMA(huart, hdmatx, hdma_usart2_tx);
+
+		HAL_NVIC_SetPriority(USART2_IRQn, 0, 0);
+		HAL_NVIC_EnableIRQ(USART2_IRQn);
+	}
+}
+
+static void MX_GPIO_Init(void)
+{
+	GPIO_InitTypeDef GPIO_InitStruct;
+
+	GPIO_InitStruct.Pin = GPIO_PIN_5 | GPIO_PIN_6;
+	GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_PP;
+	GPIO_InitStruct.Pull = GPIO_NOPULL;
+	GPIO_InitStruct.Speed = GPIO_SPEED_LOW;
+	HAL_GPIO_Init(GPIOA, &GPIO_InitStruct);
+}
+
+static void MX_DMA_Init(void)
+{
+	HAL_NVIC_SetPriority(DMA1_Channel4_5_IRQn, 0, 0);
+	HAL_NVIC_EnableIRQ(DMA1_Channel4_5_IRQn);
+}
+
+static void MX_I2C1_Init(void)
+{
+	hi2c1.Instance = I2C1;
+	hi2c1.Init.Timing = 0x2000090E;
+	hi2c1.Init.OwnAddress1 = 0;
+	hi2c1.Init.AddressingMode = I2C_ADDRESSINGMODE_7BIT;
+	hi2c1.Init.DualAddressMode = I2C_DUALADDRESS_DISABLE;
+	hi2c1.Init.OwnAddress2 = 0;
+	hi2c1.Init.OwnAddress2Masks = I2C_OA2_NOMASK;
+	hi2c1.Init.GeneralCallMode = I2C_GENERALCALL_DISABLE;
+	hi2c1.Init.NoStretchMode = I2C_NOSTRETCH_ENABLE;
+	HAL_I2C_Init(&hi2c1);
+}
+
+static void MX_USART2_UART_Init(void)
+{
+	huart2.Instance = USART2;
+	huart2.Init.BaudRate = SETUP_BAUDRATE;
+#ifdef SETUP_MUTEMODE
+	huart2.Init.WordLength = UART_WORDLENGTH_9B;
+#else
+	huart2.Init.WordLength = UART_WORDLENGTH_8B;
+#endif
+	huart2.Init.StopBits = UART_STOPBITS_1;
+	huart2.Init.Parity = UART_PARITY_NONE;
+	huart2.Init.Mode = UART_MODE_TX_RX;
+	huart2.Init.HwFlowCtl = UART_HWCONTROL_NONE;
+	huart2.Init.OverSampling = UART_OVERSAMPLING_16;
+	huart2.Init.OneBitSampling = UART_ONE_BIT_SAMPLE_DISABLE;
+	huart2.AdvancedInit.AdvFeatureInit = UART_ADVFEATURE_NO_INIT;
+	HAL_RS485Ex_Init(&huart2, UART_DE_POLARITY_HIGH, SETUP_DE_ASSERT, SETUP_DE_DEASSERT);
+}
+
+static void MX_NVIC_Init(void)
+{
+	HAL_NVIC_SetPriority(USART2_IRQn, 0, 0);
+	HAL_NVIC_EnableIRQ(USART2_IRQn);
+	HAL_NVIC_SetPriority(I2C1_IRQn, 0, 0);
+	HAL_NVIC_EnableIRQ(I2C1_IRQn);
+}
+
+/* Peripherals, like main() up to the application init */
+void board_init(void)
+{
+	HAL_Init();
+	MX_GPIO_Init();
+	MX_DMA_Init();
+	MX_I2C1_Init();
+	MX_USART2_UART_Init();
+	MX_NVIC_Init();
+}
+
+/* Application init of main(), attach simulated sensors before */
+void board_start(void)
+{
+	hdlc_init();
+	uart_rx_start();
+	sampler_init();
+}
+
+/* One pass of the main loop */
+void board_loop(void)
+{
+	hdlc_process();
+	uart_baud_process();
+	sampler_process();
+	i2c_bus_process();
+	host_advance_us(HOST_LOOP_COST_US);
+}
+
+void board_run_us(uint64_t us)
+{
+	uint64_t tend = host_time_us() + us;
+
+	while (host_time_us() < tend)
+		board_loop();
+}
@@ -0,0 +1,344 @@
+/**
+  ******************************************************************************
+  * File Name          : hal_core.c
+  * Description        : Virtual clock, NVIC, SysTick and GPIO for host builds
+  ******************************************************************************
+  *
+  * Copyright (c) 2016 S54MTB
+  * Licensed under Apache License 2.0
+  * http://www.apache.org/licenses/LICENSE-2.0.html
+  *
+  ******************************************************************************
+  */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "host.h"
+
+/* Interrupt handlers of stm32f0xx_it.c, not linked into every host program */
+extern void SysTick_Handler(void) __attribute__((weak));
+extern void USART2_IRQHandler(void) __attribute__((weak));
+extern void DMA1_Channel4_5_IRQHandler(void) __attribute__((weak));
+extern void I2C1_IRQHandler(void) __attribute__((weak));
+
+#define HOST_EVENTS				4096
+#define HOST_IRQS					32					// SysTick at 0, IRQn + 1 for the rest
+#define HOST_IRQ_STORM		100000			// handler runs without time passing
+
+typedef struct
+{
+	uint64_t				t;
+	uint64_t				seq;					// keeps order of events at the same time
+	host_event_fn		fn;
+	uint32_t				arg0, arg1;
+} host_event_t;
+
+static host_event_t	events[HOST_EVENTS];	// binary heap, earliest first
+static uint32_t			nevents;
+static uint64_t			event_seq;
+static uint64_t			now;
+
+static uint8_t			primask;
+static uint8_t			in_irq;
+static uint32_t			irq_enabled;
+static uint32_t			irq_pending;
+static uint32_t			(*irq_line[HOST_IRQS])(void);
+static uint32_t			irq_storm;
+static uint64_t			irq_storm_t;
+
+static volatile uint32_t uwTick;
+static uint8_t			systick_running;
+
+GPIO_TypeDef host_gpioa, host_gpiof;
+
+
+/* Virtual clock -------------------------------------------------------------*/
+
+static int host_event_before(const host_event_t *a, const host_event_t *b)
+{
+	return (a->t < b->t) || ((a->t == b->t) && (a->seq < b->seq));
+}
+
+void host_schedule(uint64_t t_us, host_event_fn fn, uint32_t arg0, uint32_t arg1)
+{
+	uint32_t i, parent;
+	host_event_t e;
+
+	if (nevents == HOST_EVENTS)
+	{
+		fprintf(stderr, "host: event queue full\n");
+		abort();
+	}
+	e.t = (t_us < now) ? now : t_us;
+	e.seq = event_seq++;
+	e.fn = fn;
+	e.arg0 = arg0;
+	e.arg1 = arg1;
+
+	i = nevents++;
+	while (i > 0)
+	{
+		parent = (i - 1) / 2;
+		if (!host_event_before(&e, &events[parent]))
+			break;
+		events[i] = events[parent];
+		i = parent;
+	}
+	events[i] = e;
+}
+
+static host_event_t host_event_pop(void)
+{
+	host_event_t top = events[0], last = events[--nevents];
+	uint32_t i = 0, child;
+
+	while ((child = 2*i + 1) < nevents)
+	{
+		if ((child + 1 < nevents) && host_event_before(&events[child + 1], &events[child]))
+			child++;
+		if (!host_event_before(&events[child], &last))
+			break;
+		events[i] = events[child];
+		i = child;
+	}
+	events[i] = last;
+	return top;
+}
+
+uint64_t host_time_us(void)
+{
+	return now;
+}
+
+uint64_t host_next_event(void)
+{
+	return nevents ? events[0].t : now;
+}
+
+/* Run all events up to t_us, interrupts are served after each one */
+void host_advance_to(uint64_t t_us)
+{
+	host_event_t e;
+
+	while ((nevents > 0) && (events[0].t <= t_us))
+	{
+		e = host_event_pop();
+		if (e.t > now)
+			now = e.t;
+		e.fn(e.arg0, e.arg1);
+		host_irq_dispatch();
+	}
+	if (t_us > now)
+		now = t_us;
+	host_irq_dispatch();
+}
+
+void host_advance_us(uint64_t us)
+{
+	host_advance_to(now + us);
+}
+
+/* Drop all events and interrupt state, for tests that run several boards */
+void host_reset(void)
+{
+	nevents = 0;
+	now = 0;
+	primask = 0;
+	in_irq = 0;
+	irq_enabled = 0;
+	irq_pending = 0;
+	uwTick = 0;
+	systick_running = 0;
+}
+
+
+/* NVIC ----------------------------------------------------------------------*/
+
+static void (*host_irq_handler(uint32_t i))(void)
+{
+	switch ((int)i - 1)
+	{
+		case SysTick_IRQn:					return SysTick_Handler;
+		case USART2_IRQn:						return USART2_IRQHandler;
+		case DMA1_Channel4_5_IRQn:	return DMA1_Channel4_5_IRQHandler;
+		case I2C1_IRQn:							return I2C1_IRQHandler;
+		default:										return NULL;
+	}
+}
+
+/* Level of a peripheral interrupt request, checked on every dispatch */
+void host_irq_set_line(IRQn_Type irq, uint32_t (*line)(void))
+{
+	irq_line[irq + 1] = line;
+}
+
+void host_irq_pend(IRQn_Type irq)
+{
+	irq_pending |= 1UL << (irq + 1);
+}
+
+/* Highest priority pending interrupt, masked or not, -1 for none */
+static int host_irq_next(void)
+{
+	uint32_t i, bit;
+
+	for (i=0; i<HOST_IRQS; i++)
+	{
+		bit = 1UL << i;
+		if ((i != 0) && !(irq_enabled & bit))
+			continue;
+		if ((irq_pending & bit) || ((irq_line[i] != NULL) && irq_line[i]()))
+			return i;
+	}
+	return -1;
+}
+
+void host_irq_dispatch(void)
+{
+	int i;
+	void (*handler)(void);
+
+	if (primask | in_irq)
+		return;
+	while ((i = host_irq_next()) >= 0)
+	{
+		irq_pending &= ~(1UL << i);
+		if (irq_storm_t != now)
+		{
+			irq_storm_t = now;
+			irq_storm = 0;
+		}
+		if (++irq_storm > HOST_IRQ_STORM)
+		{
+			fprintf(stderr, "host: interrupt %d is never cleared\n", i - 1);
+			abort();
+		}
+		handler = host_irq_handler(i);
+		if (handler == NULL)
+			continue;
+		in_irq = 1;
+		handler();
+		in_irq = 0;
+	}
+}
+
+void __disable_irq(void)
+{
+	primask = 1;
+}
+
+void __enable_irq(void)
+{
+	primask = 0;
+	host_irq_dispatch();
+}
+
+/* Sleep until an interrupt is pending, PRIMASK does not prevent wake up */
+void __WFI(void)
+{
+	if (host_irq_next() >= 0)
+		return;
+	if (nevents == 0)
+		host_advance_us(1);
+	else
+		host_advance_to(host_next_event());
+}
+
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority)
+{
+	// all interrupts run at the same priority
+}
+
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn)
+{
+	irq_enabled |= 1UL << (IRQn + 1);
+	host_irq_dispatch();
+}
+
+void HAL_NVIC_DisableIRQ(IRQn_Type IRQn)
+{
+	irq_enabled &= ~(1UL << (IRQn + 1));
+}
+
+
+/* HAL core ------------------------------------------------------------------*/
+
+static void host_systick(uint32_t arg0, uint32_t arg1)
+{
+	host_irq_pend(SysTick_IRQn);
+	host_schedule(now + 1000, host_systick, 0, 0);
+}
+
+HAL_StatusTypeDef HAL_Init(void)
+{
+	if (!systick_running)
+	{
+		systick_running = 1;
+		host_schedule(now + 1000, host_systick, 0, 0);
+	}
+	return HAL_OK;
+}
+
+void HAL_IncTick(void)
+{
+	uwTick++;
+}
+
+uint32_t HAL_GetTick(void)
+{
+	host_advance_us(HOST_TICK_COST_US);
+	return uwTick;
+}
+
+void HAL_Delay(uint32_t Delay)
+{
+	uint32_t tickstart = HAL_GetTick();
+
+	while ((HAL_GetTick() - tickstart) < Delay)
+	{
+	}
+}
+
+__weak void HAL_SYSTICK_Callback(void)
+{
+}
+
+void HAL_SYSTICK_IRQHandler(void)
+{
+	HAL_SYSTICK_Callback();
+}
+
+uint32_t HAL_RCC_GetHCLKFreq(void)
+{
+	return HOST_PCLK_HZ;
+}
+
+uint32_t HAL_RCC_GetPCLK1Freq(void)
+{
+	return HOST_PCLK_HZ;
+}
+
+
+/* GPIO ----------------------------------------------------------------------*/
+
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init)
+{
+	uint32_t pin;
+
+	for (pin=0; pin<16; pin++)
+		if (GPIO_Init->Pin & (1UL << pin))
+			GPIOx->MODER = (GPIOx->MODER & ~(3UL << 2*pin)) | ((GPIO_Init->Mode & 3) << 2*pin);
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+	if (PinState != GPIO_PIN_RESET)
+		GPIOx->ODR |= GPIO_Pin;
+	else
+		GPIOx->ODR &= ~(uint32_t)GPIO_Pin;
+}
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+	return (GPIOx->IDR & GPIO_Pin) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+}
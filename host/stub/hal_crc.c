@@ -0,0 +1,94 @@
+/**
+  ******************************************************************************
+  * File Name          : hal_crc.c
+  * Description        : CRC unit with programmable polynomial for host builds
+  ******************************************************************************
+  *
+  * Copyright (c) 2016 S54MTB
+  * Licensed under Apache License 2.0
+  * http://www.apache.org/licenses/LICENSE-2.0.html
+  *
+  ******************************************************************************
+
+  Register model of the CRC unit of STM32F071/072/078/091/098: POL, INIT
+  and POLYSIZE are used, reset loads INIT into DR. Byte writes to DR are
+  shifted in MSB first, bit reversal is not modelled.
+  */
+#include "host.h"
+
+CRC_TypeDef host_crc;
+
+
+static uint32_t host_crc_width(CRC_TypeDef *crc)
+{
+	switch (crc->CR & CRC_CR_POLYSIZE)
+	{
+		case CRC_POLYLENGTH_16B:	return 16;
+		case CRC_POLYLENGTH_8B:		return 8;
+		case CRC_POLYLENGTH_7B:		return 7;
+		default:									return 32;
+	}
+}
+
+void host_crc_reset(CRC_TypeDef *crc)
+{
+	crc->DR = crc->INIT;
+}
+
+/* 8-bit write to DR */
+static void host_crc_byte(CRC_TypeDef *crc, uint8_t byte)
+{
+	uint32_t width = host_crc_width(crc);
+	uint32_t top = 1UL << (width - 1);
+	uint32_t mask = (width == 32) ? 0xffffffffUL : (1UL << width) - 1;
+	uint32_t r = crc->DR & mask;
+	uint8_t i;
+
+	for (i=0; i<8; i++)
+	{
+		if (((r & top) != 0) ^ ((byte & 0x80) != 0))
+			r = ((r << 1) ^ crc->POL) & mask;
+		else
+			r = (r << 1) & mask;
+		byte <<= 1;
+	}
+	crc->DR = r;
+}
+
+HAL_StatusTypeDef HAL_CRC_Init(CRC_HandleTypeDef *hcrc)
+{
+	CRC_TypeDef *crc;
+
+	if (hcrc == NULL)
+		return HAL_ERROR;
+	crc = hcrc->Instance;
+	hcrc->State = HAL_CRC_STATE_BUSY;
+	crc->POL = (hcrc->Init.DefaultPolynomialUse == DEFAULT_POLYNOMIAL_ENABLE) ? 0x04c11db7 :
+	           hcrc->Init.GeneratingPolynomial;
+	crc->CR = (crc->CR & ~CRC_CR_POLYSIZE) |
+	          ((hcrc->Init.DefaultPolynomialUse == DEFAULT_POLYNOMIAL_ENABLE) ? CRC_POLYLENGTH_32B : hcrc->Init.CRCLength);
+	crc->INIT = (hcrc->Init.DefaultInitValueUse == DEFAULT_INIT_VALUE_ENABLE) ? 0xffffffff :
+	            hcrc->Init.InitValue;
+	host_crc_reset(crc);
+	hcrc->State = HAL_CRC_STATE_READY;
+	return HAL_OK;
+}
+
+/* Byte input format only, the only one used by crc.c */
+uint32_t HAL_CRC_Accumulate(CRC_HandleTypeDef *hcrc, uint32_t pBuffer[], uint32_t BufferLength)
+{
+	const uint8_t *p = (const uint8_t *)pBuffer;
+	uint32_t i;
+
+	hcrc->State = HAL_CRC_STATE_BUSY;
+	for (i=0; i<BufferLength; i++)
+		host_crc_byte(hcrc->Instance, p[i]);
+	hcrc->State = HAL_CRC_STATE_READY;
+	return hcrc->Instance->DR;
+}
+
+uint32_t HAL_CRC_Calculate(CRC_HandleTypeDef *hcrc, uint32_t pBuffer[], uint32_t BufferLength)
+{
+	host_crc_reset(hcrc->Instance);
+	return HAL_CRC_Accumulate(hcrc, pBuffer, BufferLength);
+}
@@ -0,0 +1,203 @@
+/**
+  ******************************************************************************
+  * File Name          : hal_i2c.c
+  * Description        : I2C1 master with simulated slaves for host builds
+  ******************************************************************************
+  *
+  * Copyright (c) 2016 S54MTB
+  * Licensed under Apache License 2.0
+  * http://www.apache.org/licenses/LICENSE-2.0.html
+  *
+  ******************************************************************************
+
+  Interrupt transfers run on the virtual clock, 9 bit times per byte. The
+  slave answers the address byte first, a NACK ends the transfer after it.
+  Completion and NACK raise the I2C1 interrupt, the event handler then
+  calls the HAL callbacks like the interrupt state machine of the HAL.
+  */
+#include <string.h>
+#include "host.h"
+
+I2C_TypeDef host_i2c1;
+
+static host_i2c_dev_t	*devs;
+static I2C_HandleTypeDef	*xfer_hi2c;		// running transfer
+static host_i2c_dev_t	*xfer_dev;
+static uint32_t				xfer_id;					// drops events of an aborted transfer
+
+
+static uint32_t host_i2c_line(void)
+{
+	return host_i2c1.ISR & (I2C_ISR_NACKF | I2C_ISR_STOPF | I2C_ISR_BERR | I2C_ISR_ARLO | I2C_ISR_OVR);
+}
+
+void host_i2c_attach(host_i2c_dev_t *dev)
+{
+	dev->next = devs;
+	devs = dev;
+	host_irq_set_line(I2C1_IRQn, host_i2c_line);
+}
+
+void host_i2c_detach_all(void)
+{
+	devs = NULL;
+}
+
+static host_i2c_dev_t *host_i2c_find(uint8_t addr)
+{
+	host_i2c_dev_t *d;
+
+	for (d = devs; d != NULL; d = d->next)
+		if (d->addr == addr)
+			return d;
+	return NULL;
+}
+
+
+/* Data bytes done, slave gets or delivers them at STOP */
+static void host_i2c_data(uint32_t id, uint32_t arg1)
+{
+	I2C_HandleTypeDef *hi2c = xfer_hi2c;
+
+	if ((id != xfer_id) || (hi2c == NULL))
+		return;
+	if (hi2c->State == HAL_I2C_STATE_BUSY_TX)
+	{
+		if (xfer_dev->write != NULL)
+			xfer_dev->write(xfer_dev, hi2c->pBuffPtr, hi2c->XferSize);
+	}
+	else
+	{
+		memset(hi2c->pBuffPtr, 0xff, hi2c->XferSize);   // bus pulled up
+		if (xfer_dev->read != NULL)
+			xfer_dev->read(xfer_dev, hi2c->pBuffPtr, hi2c->XferSize);
+	}
+	hi2c->XferCount = 0;
+	host_i2c1.ISR |= I2C_ISR_STOPF;
+}
+
+/* Address byte done */
+static void host_i2c_address(uint32_t id, uint32_t read)
+{
+	I2C_HandleTypeDef *hi2c = xfer_hi2c;
+	uint8_t addr;
+
+	if ((id != xfer_id) || (hi2c == NULL))
+		return;
+	addr = (uint8_t)(hi2c->Instance->CR2 >> 1) & 0x7f;
+	xfer_dev = host_i2c_find(addr);
+	if ((xfer_dev == NULL) || (xfer_dev->start(xfer_dev, (uint8_t)read) != 0))
+	{
+		host_i2c1.ISR |= I2C_ISR_NACKF | I2C_ISR_STOPF;
+		return;
+	}
+	host_schedule(host_time_us() + 9 * HOST_I2C_BIT_US * hi2c->XferSize + HOST_I2C_BIT_US,
+	              host_i2c_data, id, 0);
+}
+
+static HAL_StatusTypeDef host_i2c_start(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint8_t read)
+{
+	if (hi2c->State != HAL_I2C_STATE_READY)
+		return HAL_BUSY;
+	if ((pData == NULL) || (Size == 0))
+		return HAL_ERROR;
+
+	hi2c->State = read ? HAL_I2C_STATE_BUSY_RX : HAL_I2C_STATE_BUSY_TX;
+	hi2c->ErrorCode = HAL_I2C_ERROR_NONE;
+	hi2c->pBuffPtr = pData;
+	hi2c->XferSize = Size;
+	hi2c->XferCount = Size;
+	hi2c->Instance->CR2 = DevAddress & 0xfe;
+	hi2c->Instance->ISR |= I2C_ISR_BUSY;
+
+	xfer_hi2c = hi2c;
+	host_schedule(host_time_us() + 10 * HOST_I2C_BIT_US, host_i2c_address, ++xfer_id, read);
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Transmit_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size)
+{
+	return host_i2c_start(hi2c, DevAddress, pData, Size, 0);
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Receive_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size)
+{
+	return host_i2c_start(hi2c, DevAddress, pData, Size, 1);
+}
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *hi2c)
+{
+	if (hi2c == NULL)
+		return HAL_ERROR;
+	hi2c->Instance->ISR = 0;
+	hi2c->Instance->TIMINGR = hi2c->Init.Timing;
+	hi2c->Instance->CR1 |= I2C_CR1_PE;
+	hi2c->ErrorCode = HAL_I2C_ERROR_NONE;
+	hi2c->State = HAL_I2C_STATE_READY;
+	host_irq_set_line(I2C1_IRQn, host_i2c_line);
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef *hi2c)
+{
+	if (hi2c == NULL)
+		return HAL_ERROR;
+	xfer_id++;                // running transfer is lost
+	xfer_hi2c = NULL;
+	hi2c->Instance->CR1 &= ~I2C_CR1_PE;
+	hi2c->Instance->ISR = 0;
+	hi2c->ErrorCode = HAL_I2C_ERROR_NONE;
+	hi2c->State = HAL_I2C_STATE_RESET;
+	return HAL_OK;
+}
+
+/* NACK and STOP, in this order like the HAL interrupt state machine */
+void HAL_I2C_EV_IRQHandler(I2C_HandleTypeDef *hi2c)
+{
+	HAL_I2C_StateTypeDef state = hi2c->State;
+
+	if (hi2c->Instance->ISR & I2C_ISR_NACKF)
+	{
+		hi2c->Instance->ISR &= ~I2C_ISR_NACKF;
+		hi2c->ErrorCode |= HAL_I2C_ERROR_AF;
+	}
+	if (hi2c->Instance->ISR & I2C_ISR_STOPF)
+	{
+		hi2c->Instance->ISR &= ~(I2C_ISR_STOPF | I2C_ISR_BUSY);
+		xfer_hi2c = NULL;
+		hi2c->State = HAL_I2C_STATE_READY;
+		if (hi2c->ErrorCode != HAL_I2C_ERROR_NONE)
+			HAL_I2C_ErrorCallback(hi2c);
+		else if (state == HAL_I2C_STATE_BUSY_TX)
+			HAL_I2C_MasterTxCpltCallback(hi2c);
+		else if (state == HAL_I2C_STATE_BUSY_RX)
+			HAL_I2C_MasterRxCpltCallback(hi2c);
+	}
+}
+
+void HAL_I2C_ER_IRQHandler(I2C_HandleTypeDef *hi2c)
+{
+	if (hi2c->Instance->ISR & I2C_ISR_BERR)
+		hi2c->ErrorCode |= HAL_I2C_ERROR_BERR;
+	if (hi2c->Instance->ISR & I2C_ISR_ARLO)
+		hi2c->ErrorCode |= HAL_I2C_ERROR_ARLO;
+	if (hi2c->Instance->ISR & I2C_ISR_OVR)
+		hi2c->ErrorCode |= HAL_I2C_ERROR_OVR;
+	hi2c->Instance->ISR &= ~(I2C_ISR_BERR | I2C_ISR_ARLO | I2C_ISR_OVR | I2C_ISR_BUSY);
+	xfer_id++;
+	xfer_hi2c = NULL;
+	hi2c->State = HAL_I2C_STATE_READY;
+	HAL_I2C_ErrorCallback(hi2c);
+}
+
+__weak void HAL_I2C_MasterTxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+}
+
+__weak void HAL_I2C_MasterRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+}
+
+__weak void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+{
+}
@@ -0,0 +1,717 @@
+/**
+  ******************************************************************************
+  * File Name          : hal_uart.c
+  * Description        : USART2 and its DMA channels for host builds
+  ******************************************************************************
+  *
+  * Copyright (c) 2016 S54MTB
+  * Licensed under Apache License 2.0
+  * http://www.apache.org/licenses/LICENSE-2.0.html
+  *
+  ******************************************************************************
+
+  Characters arrive on the virtual clock with the sender's rate and word
+  length. The receiver samples them at its own bit centers, so a wrong
+  rate gives wrong data and framing errors as on the wire. Mute mode with
+  address mark, character match, idle line, auto baud rate on 0x7F,
+  overrun and the RS485 driver enable timing are modelled, together with
+  DMA channel 4 (TX) and 5 (RX, circular). HAL functions follow the
+  STM32Cube F0 HAL in hal/, including its error interrupt handling.
+  */
+#include <string.h>
+#include "host.h"
+
+USART_TypeDef host_usart2;
+DMA_TypeDef host_dma1;
+DMA_Channel_TypeDef host_dma1_channel4, host_dma1_channel5;
+
+static const host_uart_hooks_t *hooks;
+
+static uint8_t	*dma_mem[2];				// channel 4, 5 memory, CMAR is too narrow on host
+static uint32_t	dma_len[2];					// programmed transfer length
+
+static uint64_t	rx_line_free;				// end of the last character queued by host_uart_rx()
+static uint32_t	rx_activity;				// start bits seen, for idle line detection
+static uint8_t	rx_idle_armed;			// character received since last idle line
+
+static uint8_t	tx_active;
+static uint32_t	tx_id;							// drops events of an aborted transmission
+static uint64_t	tx_start;						// first start bit of the burst
+static uint32_t	tx_count;						// characters sent in the burst
+
+
+/* Helpers -------------------------------------------------------------------*/
+
+uint32_t host_uart_baud(void)
+{
+	return host_usart2.BRR ? HOST_PCLK_HZ / host_usart2.BRR : 0;
+}
+
+uint8_t host_uart_bits(void)
+{
+	return (host_usart2.CR1 & USART_CR1_M) ? 9 : 8;
+}
+
+uint8_t host_uart_tx_active(void)
+{
+	return tx_active;
+}
+
+void host_uart_set_hooks(const host_uart_hooks_t *h)
+{
+	hooks = h;
+}
+
+/* Time of n characters (start, data, stop bit) in us */
+static uint64_t host_uart_chars_us(uint32_t n, uint8_t bits, uint32_t baud)
+{
+	return ((uint64_t)n * (bits + 2) * 1000000UL + baud - 1) / baud;
+}
+
+static uint32_t host_usart_line(void)
+{
+	uint32_t isr = host_usart2.ISR, cr1 = host_usart2.CR1, cr3 = host_usart2.CR3;
+
+	return ((isr & USART_ISR_IDLE) && (cr1 & USART_CR1_IDLEIE)) ||
+	       ((isr & USART_ISR_CMF)  && (cr1 & USART_CR1_CMIE)) ||
+	       ((isr & USART_ISR_TC)   && (cr1 & USART_CR1_TCIE)) ||
+	       ((isr & USART_ISR_RXNE) && (cr1 & USART_CR1_RXNEIE)) ||
+	       ((isr & USART_ISR_TXE)  && (cr1 & USART_CR1_TXEIE)) ||
+	       ((isr & USART_ISR_PE)   && (cr1 & USART_CR1_PEIE)) ||
+	       ((isr & (USART_ISR_FE | USART_ISR_NE | USART_ISR_ORE)) && (cr3 & USART_CR3_EIE));
+}
+
+
+/* DMA -----------------------------------------------------------------------*/
+
+static uint32_t host_dma_index(DMA_Channel_TypeDef *ch)
+{
+	return (ch == DMA1_Channel4) ? 0 : 1;
+}
+
+static uint32_t host_dma_shift(DMA_Channel_TypeDef *ch)
+{
+	return (ch == DMA1_Channel4) ? 12 : 16;     // 4 flags per channel
+}
+
+static uint32_t host_dma_line(void)
+{
+	return ((host_dma1.ISR >> host_dma_shift(DMA1_Channel4)) & DMA1_Channel4->CCR & 0x0e) ||
+	       ((host_dma1.ISR >> host_dma_shift(DMA1_Channel5)) & DMA1_Channel5->CCR & 0x0e);
+}
+
+static void host_dma_flag(DMA_Channel_TypeDef *ch, uint32_t flag)
+{
+	host_dma1.ISR |= (flag | DMA_ISR_GIF1) << host_dma_shift(ch);
+}
+
+/* One data item moved, returns memory address of it */
+static uint8_t *host_dma_item(DMA_Channel_TypeDef *ch)
+{
+	uint32_t i = host_dma_index(ch);
+	uint8_t *p = &dma_mem[i][dma_len[i] - ch->CNDTR];
+
+	ch->CNDTR--;
+	if (ch->CNDTR == dma_len[i] - dma_len[i] / 2)
+		host_dma_flag(ch, DMA_ISR_HTIF1);
+	if (ch->CNDTR == 0)
+	{
+		host_dma_flag(ch, DMA_ISR_TCIF1);
+		if (ch->CCR & DMA_CCR_CIRC)
+			ch->CNDTR = dma_len[i];
+	}
+	return p;
+}
+
+static void host_dma_start(DMA_HandleTypeDef *hdma, uint8_t *mem, uint32_t len)
+{
+	DMA_Channel_TypeDef *ch = hdma->Instance;
+
+	ch->CCR &= ~DMA_CCR_EN;
+	host_dma1.IFCR = 0x0f << host_dma_shift(ch);
+	host_dma1.ISR &= ~(0x0fUL << host_dma_shift(ch));
+	dma_mem[host_dma_index(ch)] = mem;
+	dma_len[host_dma_index(ch)] = len;
+	ch->CNDTR = len;
+	ch->CCR |= DMA_IT_TC | DMA_IT_HT | DMA_IT_TE;
+	ch->CCR |= DMA_CCR_EN;
+	hdma->State = HAL_DMA_STATE_BUSY;
+	host_irq_set_line(DMA1_Channel4_5_IRQn, host_dma_line);
+}
+
+void host_dma_error(DMA_Channel_TypeDef *ch)
+{
+	ch->CCR &= ~DMA_CCR_EN;
+	host_dma_flag(ch, DMA_ISR_TEIF1);
+	host_irq_set_line(DMA1_Channel4_5_IRQn, host_dma_line);
+}
+
+HAL_StatusTypeDef HAL_DMA_Init(DMA_HandleTypeDef *hdma)
+{
+	if (hdma == NULL)
+		return HAL_ERROR;
+	hdma->Instance->CCR = hdma->Init.Direction | hdma->Init.PeriphInc | hdma->Init.MemInc |
+	                      hdma->Init.PeriphDataAlignment | hdma->Init.MemDataAlignment |
+	                      hdma->Init.Mode | hdma->Init.Priority;
+	hdma->ErrorCode = HAL_DMA_ERROR_NONE;
+	hdma->State = HAL_DMA_STATE_READY;
+	hdma->Lock = HAL_UNLOCKED;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMA_Abort(DMA_HandleTypeDef *hdma)
+{
+	hdma->Instance->CCR &= ~(DMA_IT_TC | DMA_IT_HT | DMA_IT_TE);
+	hdma->Instance->CCR &= ~DMA_CCR_EN;
+	hdma->State = HAL_DMA_STATE_READY;
+	hdma->Lock = HAL_UNLOCKED;
+	return HAL_OK;
+}
+
+void HAL_DMA_IRQHandler(DMA_HandleTypeDef *hdma)
+{
+	DMA_Channel_TypeDef *ch = hdma->Instance;
+	uint32_t shift = host_dma_shift(ch);
+
+	if (((host_dma1.ISR >> shift) & DMA_ISR_TEIF1) && (ch->CCR & DMA_IT_TE))
+	{
+		ch->CCR &= ~DMA_IT_TE;
+		host_dma1.ISR &= ~(DMA_ISR_TEIF1 << shift);
+		hdma->ErrorCode |= HAL_DMA_ERROR_TE;
+		hdma->State = HAL_DMA_STATE_ERROR;
+		hdma->Lock = HAL_UNLOCKED;
+		if (hdma->XferErrorCallback != NULL)
+			hdma->XferErrorCallback(hdma);
+	}
+	if (((host_dma1.ISR >> shift) & DMA_ISR_HTIF1) && (ch->CCR & DMA_IT_HT))
+	{
+		if (!(ch->CCR & DMA_CCR_CIRC))
+			ch->CCR &= ~DMA_IT_HT;
+		host_dma1.ISR &= ~(DMA_ISR_HTIF1 << shift);
+		hdma->State = HAL_DMA_STATE_READY_HALF;
+		if (hdma->XferHalfCpltCallback != NULL)
+			hdma->XferHalfCpltCallback(hdma);
+	}
+	if (((host_dma1.ISR >> shift) & DMA_ISR_TCIF1) && (ch->CCR & DMA_IT_TC))
+	{
+		if (!(ch->CCR & DMA_CCR_CIRC))
+			ch->CCR &= ~DMA_IT_TC;
+		host_dma1.ISR &= ~(DMA_ISR_TCIF1 << shift);
+		hdma->ErrorCode = HAL_DMA_ERROR_NONE;
+		hdma->State = HAL_DMA_STATE_READY;
+		hdma->Lock = HAL_UNLOCKED;
+		if (hdma->XferCpltCallback != NULL)
+			hdma->XferCpltCallback(hdma);
+	}
+	if (!((host_dma1.ISR >> shift) & 0x0e))
+		host_dma1.ISR &= ~(DMA_ISR_GIF1 << shift);
+}
+
+
+/* Register side effects -----------------------------------------------------*/
+
+static void host_uart_tx_abort(void)
+{
+	if (tx_active && (hooks != NULL) && (hooks->de != NULL))
+		hooks->de(host_time_us(), 0);
+	tx_active = 0;
+	tx_id++;
+}
+
+/* UE cleared resets the status flags and stops the transmitter */
+void host_usart_cr1(USART_TypeDef *usart, uint32_t cr1)
+{
+	if ((usart->CR1 & USART_CR1_UE) && !(cr1 & USART_CR1_UE))
+	{
+		usart->ISR = 0;
+		rx_idle_armed = 0;
+		host_uart_tx_abort();
+	}
+	if (!(usart->CR1 & USART_CR1_UE) && (cr1 & USART_CR1_UE))
+		usart->ISR |= USART_ISR_TXE | USART_ISR_TC | USART_ISR_TEACK | USART_ISR_REACK;
+	usart->CR1 = cr1;
+	host_irq_set_line(USART2_IRQn, host_usart_line);
+}
+
+void host_usart_icr(USART_TypeDef *usart, uint32_t clear)
+{
+	usart->ISR &= ~(clear & (USART_ICR_PECF | USART_ICR_FECF | USART_ICR_NCF | USART_ICR_ORECF |
+	                         USART_ICR_IDLECF | USART_ICR_TCCF | USART_ICR_CMCF));
+}
+
+void host_usart_rqr(USART_TypeDef *usart, uint32_t request)
+{
+	if ((request & USART_RQR_MMRQ) && (usart->CR1 & USART_CR1_MME))
+		usart->ISR |= USART_ISR_RWU;
+	if (request & USART_RQR_RXFRQ)
+		usart->ISR &= ~USART_ISR_RXNE;
+	if (request & USART_RQR_ABRRQ)
+		usart->ISR &= ~(USART_ISR_ABRF | USART_ISR_ABRE);
+}
+
+
+/* Receiver ------------------------------------------------------------------*/
+
+/* Character as seen by a receiver with other rate or word length */
+static uint16_t host_uart_sample(uint16_t word, uint8_t bits, uint32_t baud,
+                                 uint8_t rbits, uint32_t rbaud, uint8_t *fe)
+{
+	uint16_t data = 0;
+	uint32_t i, k, level;
+
+	*fe = 0;
+	if ((baud == rbaud) && (bits == rbits))
+		return word;
+	for (i=0; i<=rbits; i++)      // data bits, then stop bit
+	{
+		k = (uint32_t)(((2*i + 3) * (uint64_t)baud) / (2 * (uint64_t)rbaud));   // sender bit at sample point
+		level = (k == 0) ? 0 : (k <= bits) ? (word >> (k - 1)) & 1 : 1;
+		if (i < rbits)
+			data |= level << i;
+		else
+			*fe = !level;
+	}
+	return data;
+}
+
+static void host_uart_idle(uint32_t activity, uint32_t arg1)
+{
+	USART_TypeDef *u = &host_usart2;
+
+	if ((activity != rx_activity) || !rx_idle_armed)
+		return;
+	if ((u->CR1 & (USART_CR1_UE | USART_CR1_RE)) != (USART_CR1_UE | USART_CR1_RE))
+		return;
+	u->ISR |= USART_ISR_IDLE;
+	rx_idle_armed = 0;
+}
+
+static void host_uart_start_bit(uint32_t arg0, uint32_t arg1)
+{
+	rx_activity++;
+}
+
+/* Stop bit of a character done */
+static void host_uart_receive(uint32_t arg0, uint32_t baud)
+{
+	USART_TypeDef *u = &host_usart2;
+	uint16_t word = arg0 & 0x1ff, data;
+	uint8_t bits = (arg0 >> 16) & 0x0f, err = (arg0 >> 24) & 0xff;
+	uint8_t rbits, fe, mark, match;
+	uint32_t rbaud, add = u->CR2 >> UART_CR2_ADDRESS_LSB_POS;
+
+	if ((u->CR1 & (USART_CR1_UE | USART_CR1_RE)) != (USART_CR1_UE | USART_CR1_RE))
+		return;
+
+	// auto baud rate detection on 0x7F frame measures the first character
+	if ((u->CR2 & USART_CR2_ABREN) && !(u->ISR & USART_ISR_ABRF))
+	{
+		if ((bits == 8) && ((word & 0xff) == 0x7f))
+			u->BRR = (HOST_PCLK_HZ + baud / 2) / baud;
+		else
+			u->ISR |= USART_ISR_ABRE;
+		u->ISR |= USART_ISR_ABRF;
+	}
+
+	rbaud = host_uart_baud();
+	rbits = host_uart_bits();
+	if (rbaud == 0)
+		return;
+	data = host_uart_sample(word, bits, baud, rbits, rbaud, &fe);
+	if (err & HOST_UART_ERR_FE)
+		fe = 1;
+
+	// mute mode, wake up on address mark with own address
+	mark = (data >> (rbits - 1)) & 1;
+	if (u->CR2 & USART_CR2_ADDM7)
+		match = ((data & 0x7f) == (add & 0x7f));
+	else
+		match = ((data & 0x0f) == (add & 0x0f));
+	if ((u->CR1 & USART_CR1_WAKE) && (u->CR1 & USART_CR1_MME))
+	{
+		if (u->ISR & USART_ISR_RWU)
+		{
+			if (!mark || !match)
+				return;
+			u->ISR &= ~USART_ISR_RWU;    // address character itself is received
+		}
+		else if (mark && !match)
+		{
+			u->ISR |= USART_ISR_RWU;
+			return;
+		}
+	}
+
+	rx_idle_armed = 1;
+	host_schedule(host_time_us() + host_uart_chars_us(1, rbits, rbaud), host_uart_idle, rx_activity, 0);
+
+	if (fe)
+		u->ISR |= USART_ISR_FE;
+	if (err & HOST_UART_ERR_NE)
+		u->ISR |= USART_ISR_NE;
+	if (!(u->ISR & USART_ISR_RWU) && ((data & 0xff) == (add & 0xff)))
+		u->ISR |= USART_ISR_CMF;
+
+	if ((u->CR3 & USART_CR3_DMAR) && (DMA1_Channel5->CCR & DMA_CCR_EN) && (DMA1_Channel5->CNDTR > 0))
+	{
+		*host_dma_item(DMA1_Channel5) = (uint8_t)data;
+	}
+	else if (u->ISR & USART_ISR_RXNE)
+	{
+		if (!(u->CR3 & USART_CR3_OVRDIS))
+			u->ISR |= USART_ISR_ORE;
+	}
+	else
+	{
+		u->RDR = data;
+		u->ISR |= USART_ISR_RXNE;
+	}
+}
+
+void host_uart_rx_char(uint64_t t_us, uint16_t word, uint8_t bits, uint32_t baud, uint8_t err)
+{
+	host_schedule(t_us, host_uart_start_bit, 0, 0);
+	host_schedule(t_us + host_uart_chars_us(1, bits, baud), host_uart_receive,
+	              (word & 0x1ff) | ((uint32_t)bits << 16) | ((uint32_t)err << 24), baud);
+}
+
+void host_uart_rx_words(const uint16_t *buf, uint16_t len, uint8_t bits, uint32_t baud)
+{
+	uint64_t t0 = (rx_line_free > host_time_us()) ? rx_line_free : host_time_us();
+	uint16_t i;
+
+	for (i=0; i<len; i++)
+		host_uart_rx_char(t0 + host_uart_chars_us(i, bits, baud), buf[i], bits, baud, HOST_UART_ERR_NONE);
+	rx_line_free = t0 + host_uart_chars_us(len, bits, baud);
+}
+
+void host_uart_rx(const uint8_t *buf, uint16_t len, uint32_t baud)
+{
+	uint64_t t0 = (rx_line_free > host_time_us()) ? rx_line_free : host_time_us();
+	uint16_t i;
+
+	for (i=0; i<len; i++)
+		host_uart_rx_char(t0 + host_uart_chars_us(i, 8, baud), buf[i], 8, baud, HOST_UART_ERR_NONE);
+	rx_line_free = t0 + host_uart_chars_us(len, 8, baud);
+}
+
+uint64_t host_uart_rx_idle_at(void)
+{
+	return rx_line_free;
+}
+
+
+/* Transmitter ---------------------------------------------------------------*/
+
+/* Next character slot of the burst */
+static void host_uart_tx_slot(uint32_t id, uint32_t arg1)
+{
+	USART_TypeDef *u = &host_usart2;
+	uint32_t baud = host_uart_baud(), dedt;
+	uint8_t bits = host_uart_bits();
+	uint64_t t = host_time_us();
+
+	if (id != tx_id)
+		return;
+	if ((u->CR3 & USART_CR3_DMAT) && (DMA1_Channel4->CCR & DMA_CCR_EN) && (DMA1_Channel4->CNDTR > 0))
+	{
+		if (hooks != NULL && hooks->tx_char != NULL)
+			hooks->tx_char(t, *host_dma_item(DMA1_Channel4), bits, baud);
+		else
+			host_dma_item(DMA1_Channel4);
+		tx_count++;
+		host_schedule(tx_start + host_uart_chars_us(tx_count, bits, baud), host_uart_tx_slot, id, 0);
+		return;
+	}
+	// shift register empty, driver released after deassertion time
+	u->ISR |= USART_ISR_TC;
+	tx_active = 0;
+	dedt = (u->CR1 & USART_CR1_DEDT) >> UART_CR1_DEDT_ADDRESS_LSB_POS;
+	if (hooks != NULL && hooks->de != NULL)
+		hooks->de(t + (dedt * 1000000UL) / (16UL * baud), 0);
+}
+
+static void host_uart_tx_kick(void)
+{
+	USART_TypeDef *u = &host_usart2;
+	uint32_t baud = host_uart_baud(), deat;
+
+	if (tx_active || (baud == 0) || !(u->CR1 & USART_CR1_UE) || !(u->CR1 & USART_CR1_TE))
+		return;
+	tx_active = 1;
+	tx_count = 0;
+	deat = (u->CR1 & USART_CR1_DEAT) >> UART_CR1_DEAT_ADDRESS_LSB_POS;
+	if (hooks != NULL && hooks->de != NULL)
+		hooks->de(host_time_us(), 1);
+	tx_start = host_time_us() + (deat * 1000000UL) / (16UL * baud);
+	host_schedule(tx_start, host_uart_tx_slot, tx_id, 0);
+}
+
+
+/* HAL UART ------------------------------------------------------------------*/
+
+static void UART_DMATransmitCplt(DMA_HandleTypeDef *hdma)
+{
+	UART_HandleTypeDef *huart = (UART_HandleTypeDef *)hdma->Parent;
+
+	if (!(hdma->Instance->CCR & DMA_CCR_CIRC))
+	{
+		huart->TxXferCount = 0;
+		huart->Instance->CR3 &= ~USART_CR3_DMAT;
+		__HAL_UART_ENABLE_IT(huart, UART_IT_TC);
+	}
+	else
+	{
+		HAL_UART_TxCpltCallback(huart);
+	}
+}
+
+static void UART_DMATxHalfCplt(DMA_HandleTypeDef *hdma)
+{
+	HAL_UART_TxHalfCpltCallback((UART_HandleTypeDef *)hdma->Parent);
+}
+
+static void UART_DMAReceiveCplt(DMA_HandleTypeDef *hdma)
+{
+	UART_HandleTypeDef *huart = (UART_HandleTypeDef *)hdma->Parent;
+
+	if (!(hdma->Instance->CCR & DMA_CCR_CIRC))
+	{
+		huart->RxXferCount = 0;
+		huart->Instance->CR3 &= ~USART_CR3_DMAR;
+		if (huart->State == HAL_UART_STATE_BUSY_TX_RX)
+			huart->State = HAL_UART_STATE_BUSY_TX;
+		else
+			huart->State = HAL_UART_STATE_READY;
+	}
+	HAL_UART_RxCpltCallback(huart);
+}
+
+static void UART_DMARxHalfCplt(DMA_HandleTypeDef *hdma)
+{
+	HAL_UART_RxHalfCpltCallback((UART_HandleTypeDef *)hdma->Parent);
+}
+
+static void UART_DMAError(DMA_HandleTypeDef *hdma)
+{
+	UART_HandleTypeDef *huart = (UART_HandleTypeDef *)hdma->Parent;
+
+	huart->RxXferCount = 0;
+	huart->TxXferCount = 0;
+	huart->State = HAL_UART_STATE_READY;
+	huart->ErrorCode |= HAL_UART_ERROR_DMA;
+	HAL_UART_ErrorCallback(huart);
+}
+
+static void UART_SetConfig(UART_HandleTypeDef *huart)
+{
+	USART_TypeDef *u = huart->Instance;
+
+	MODIFY_REG(u->CR1, USART_CR1_M | USART_CR1_PCE | USART_CR1_TE | USART_CR1_RE | USART_CR1_OVER8,
+	           huart->Init.WordLength | huart->Init.Parity | huart->Init.Mode | huart->Init.OverSampling);
+	MODIFY_REG(u->CR2, USART_CR2_STOP, huart->Init.StopBits);
+	u->BRR = (HOST_PCLK_HZ + huart->Init.BaudRate / 2) / huart->Init.BaudRate;
+}
+
+static void UART_AdvFeatureConfig(UART_HandleTypeDef *huart)
+{
+	if (huart->AdvancedInit.AdvFeatureInit & UART_ADVFEATURE_AUTOBAUDRATE_INIT)
+	{
+		MODIFY_REG(huart->Instance->CR2, USART_CR2_ABREN, huart->AdvancedInit.AutoBaudRateEnable);
+		if (huart->AdvancedInit.AutoBaudRateEnable == UART_ADVFEATURE_AUTOBAUDRATE_ENABLE)
+			MODIFY_REG(huart->Instance->CR2, USART_CR2_ABRMODE, huart->AdvancedInit.AutoBaudRateMode);
+	}
+}
+
+HAL_StatusTypeDef HAL_RS485Ex_Init(UART_HandleTypeDef *huart, uint32_t Polarity, uint32_t AssertionTime, uint32_t DeassertionTime)
+{
+	if (huart == NULL)
+		return HAL_ERROR;
+	if (huart->State == HAL_UART_STATE_RESET)
+	{
+		huart->Lock = HAL_UNLOCKED;
+		HAL_UART_MspInit(huart);
+	}
+	huart->State = HAL_UART_STATE_BUSY;
+	__HAL_UART_DISABLE(huart);
+	UART_SetConfig(huart);
+	if (huart->AdvancedInit.AdvFeatureInit != UART_ADVFEATURE_NO_INIT)
+		UART_AdvFeatureConfig(huart);
+	SET_BIT(huart->Instance->CR3, USART_CR3_DEM);
+	MODIFY_REG(huart->Instance->CR3, USART_CR3_DEP, Polarity);
+	MODIFY_REG(huart->Instance->CR1, USART_CR1_DEDT | USART_CR1_DEAT,
+	           (AssertionTime << UART_CR1_DEAT_ADDRESS_LSB_POS) | (DeassertionTime << UART_CR1_DEDT_ADDRESS_LSB_POS));
+	__HAL_UART_ENABLE(huart);
+	huart->ErrorCode = HAL_UART_ERROR_NONE;
+	huart->State = HAL_UART_STATE_READY;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_MultiProcessor_Init(UART_HandleTypeDef *huart, uint8_t Address, uint32_t WakeUpMethod)
+{
+	if (huart == NULL)
+		return HAL_ERROR;
+	if (huart->State == HAL_UART_STATE_RESET)
+	{
+		huart->Lock = HAL_UNLOCKED;
+		HAL_UART_MspInit(huart);
+	}
+	huart->State = HAL_UART_STATE_BUSY;
+	__HAL_UART_DISABLE(huart);
+	UART_SetConfig(huart);
+	if (huart->AdvancedInit.AdvFeatureInit != UART_ADVFEATURE_NO_INIT)
+		UART_AdvFeatureConfig(huart);
+	if (WakeUpMethod == UART_WAKEUPMETHOD_ADDRESSMARK)
+		MODIFY_REG(huart->Instance->CR2, USART_CR2_ADD, (uint32_t)Address << UART_CR2_ADDRESS_LSB_POS);
+	MODIFY_REG(huart->Instance->CR1, USART_CR1_WAKE, WakeUpMethod);
+	__HAL_UART_ENABLE(huart);
+	huart->ErrorCode = HAL_UART_ERROR_NONE;
+	huart->State = HAL_UART_STATE_READY;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_MultiProcessorEx_AddressLength_Set(UART_HandleTypeDef *huart, uint32_t AddressLength)
+{
+	huart->State = HAL_UART_STATE_BUSY;
+	__HAL_UART_DISABLE(huart);
+	MODIFY_REG(huart->Instance->CR2, USART_CR2_ADDM7, AddressLength);
+	__HAL_UART_ENABLE(huart);
+	huart->State = HAL_UART_STATE_READY;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_MultiProcessor_EnableMuteMode(UART_HandleTypeDef *huart)
+{
+	huart->State = HAL_UART_STATE_BUSY;
+	huart->Instance->CR1 |= USART_CR1_MME;
+	huart->State = HAL_UART_STATE_READY;
+	return HAL_OK;
+}
+
+void HAL_MultiProcessor_EnterMuteMode(UART_HandleTypeDef *huart)
+{
+	__HAL_UART_SEND_REQ(huart, UART_MUTE_MODE_REQUEST);
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size)
+{
+	if ((huart->State != HAL_UART_STATE_READY) && (huart->State != HAL_UART_STATE_BUSY_RX))
+		return HAL_BUSY;
+	if ((pData == NULL) || (Size == 0))
+		return HAL_ERROR;
+
+	huart->pTxBuffPtr = pData;
+	huart->TxXferSize = Size;
+	huart->TxXferCount = Size;
+	huart->ErrorCode = HAL_UART_ERROR_NONE;
+	huart->State = (huart->State == HAL_UART_STATE_BUSY_RX) ? HAL_UART_STATE_BUSY_TX_RX : HAL_UART_STATE_BUSY_TX;
+
+	huart->hdmatx->XferCpltCallback = UART_DMATransmitCplt;
+	huart->hdmatx->XferHalfCpltCallback = UART_DMATxHalfCplt;
+	huart->hdmatx->XferErrorCallback = UART_DMAError;
+	host_dma_start(huart->hdmatx, pData, Size);
+	__HAL_UART_CLEAR_FLAG(huart, UART_CLEAR_TCF);
+	huart->Instance->CR3 |= USART_CR3_DMAT;
+	host_uart_tx_kick();
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Receive_DMA(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size)
+{
+	if ((huart->State != HAL_UART_STATE_READY) && (huart->State != HAL_UART_STATE_BUSY_TX))
+		return HAL_BUSY;
+	if ((pData == NULL) || (Size == 0))
+		return HAL_ERROR;
+
+	huart->pRxBuffPtr = pData;
+	huart->RxXferSize = Size;
+	huart->ErrorCode = HAL_UART_ERROR_NONE;
+	huart->State = (huart->State == HAL_UART_STATE_BUSY_TX) ? HAL_UART_STATE_BUSY_TX_RX : HAL_UART_STATE_BUSY_RX;
+
+	huart->hdmarx->XferCpltCallback = UART_DMAReceiveCplt;
+	huart->hdmarx->XferHalfCpltCallback = UART_DMARxHalfCplt;
+	huart->hdmarx->XferErrorCallback = UART_DMAError;
+	host_dma_start(huart->hdmarx, pData, Size);
+	huart->Instance->CR3 |= USART_CR3_DMAR;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_DMAStop(UART_HandleTypeDef *huart)
+{
+	huart->Instance->CR3 &= ~USART_CR3_DMAT;
+	huart->Instance->CR3 &= ~USART_CR3_DMAR;
+	if (huart->hdmatx != NULL)
+		HAL_DMA_Abort(huart->hdmatx);
+	if (huart->hdmarx != NULL)
+		HAL_DMA_Abort(huart->hdmarx);
+	huart->State = HAL_UART_STATE_READY;
+	return HAL_OK;
+}
+
+/* As HAL_UART_IRQHandler() of hal/stm32f0xx_hal_uart_ex.c */
+void HAL_UART_IRQHandler(UART_HandleTypeDef *huart)
+{
+	if ((__HAL_UART_GET_IT(huart, UART_IT_PE) != RESET) && (__HAL_UART_GET_IT_SOURCE(huart, UART_IT_PE) != RESET))
+	{
+		__HAL_UART_CLEAR_IT(huart, UART_CLEAR_PEF);
+		huart->ErrorCode |= HAL_UART_ERROR_PE;
+		huart->State = HAL_UART_STATE_READY;
+	}
+	if ((__HAL_UART_GET_IT(huart, UART_IT_FE) != RESET) && (__HAL_UART_GET_IT_SOURCE(huart, UART_IT_ERR) != RESET))
+	{
+		__HAL_UART_CLEAR_IT(huart, UART_CLEAR_FEF);
+		huart->ErrorCode |= HAL_UART_ERROR_FE;
+		huart->State = HAL_UART_STATE_READY;
+	}
+	if ((__HAL_UART_GET_IT(huart, UART_IT_NE) != RESET) && (__HAL_UART_GET_IT_SOURCE(huart, UART_IT_ERR) != RESET))
+	{
+		__HAL_UART_CLEAR_IT(huart, UART_CLEAR_NEF);
+		huart->ErrorCode |= HAL_UART_ERROR_NE;
+		huart->State = HAL_UART_STATE_READY;
+	}
+	if ((__HAL_UART_GET_IT(huart, UART_IT_ORE) != RESET) && (__HAL_UART_GET_IT_SOURCE(huart, UART_IT_ERR) != RESET))
+	{
+		__HAL_UART_CLEAR_IT(huart, UART_CLEAR_OREF);
+		huart->ErrorCode |= HAL_UART_ERROR_ORE;
+		huart->State = HAL_UART_STATE_READY;
+	}
+	if (huart->ErrorCode != HAL_UART_ERROR_NONE)
+		HAL_UART_ErrorCallback(huart);
+
+	if ((__HAL_UART_GET_IT(huart, UART_IT_RXNE) != RESET) && (__HAL_UART_GET_IT_SOURCE(huart, UART_IT_RXNE) != RESET))
+		__HAL_UART_SEND_REQ(huart, UART_RXDATA_FLUSH_REQUEST);   // interrupt reception is not used
+
+	if ((__HAL_UART_GET_IT(huart, UART_IT_TC) != RESET) && (__HAL_UART_GET_IT_SOURCE(huart, UART_IT_TC) != RESET))
+	{
+		__HAL_UART_DISABLE_IT(huart, UART_IT_TC);
+		if (huart->State == HAL_UART_STATE_BUSY_TX_RX)
+			huart->State = HAL_UART_STATE_BUSY_RX;
+		else
+			huart->State = HAL_UART_STATE_READY;
+		HAL_UART_TxCpltCallback(huart);
+	}
+}
+
+__weak void HAL_UART_MspInit(UART_HandleTypeDef *huart)
+{
+}
+
+__weak void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+}
+
+__weak void HAL_UART_TxHalfCpltCallback(UART_HandleTypeDef *huart)
+{
+}
+
+__weak void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
+{
+}
+
+__weak void HAL_UART_RxHalfCpltCallback(UART_HandleTypeDef *huart)
+{
+}
+
+__weak void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+}
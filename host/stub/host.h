@@ -0,0 +1,101 @@
+/**
+  ******************************************************************************
+  * File Name          : host.h
+  * Description        : Virtual clock and peripheral simulator for host builds
+  ******************************************************************************
+  *
+  * Copyright (c) 2016 S54MTB
+  * Licensed under Apache License 2.0
+  * http://www.apache.org/licenses/LICENSE-2.0.html
+  *
+  ******************************************************************************
+
+  The firmware runs against a virtual clock in microseconds. Code itself
+  takes no time, every HAL_GetTick() call costs HOST_TICK_COST_US so that
+  polling loops advance, __WFI() sleeps until the next event. Peripherals
+  raise interrupts from timed events, handlers run when the clock is
+  advanced with interrupts enabled, one at a time like on the Cortex-M0
+  with all priorities equal.
+  */
+#ifndef __HOST_H__
+#define __HOST_H__
+
+#include "stm32f0xx_hal.h"
+
+#define HOST_PCLK_HZ				48000000UL	// PLL from HSI, SystemClock_Config()
+#define HOST_TICK_COST_US		1						// time of one HAL_GetTick() call
+#define HOST_LOOP_COST_US		5						// one pass of the main loop without work
+#define HOST_I2C_BIT_US			10					// I2C timing 0x2000090E is 100 kHz
+
+
+/* Virtual clock -------------------------------------------------------------*/
+typedef void (*host_event_fn)(uint32_t arg0, uint32_t arg1);
+
+uint64_t host_time_us(void);
+void host_advance_us(uint64_t us);
+void host_advance_to(uint64_t t_us);
+void host_schedule(uint64_t t_us, host_event_fn fn, uint32_t arg0, uint32_t arg1);
+uint64_t host_next_event(void);
+void host_reset(void);
+
+/* Interrupts ----------------------------------------------------------------*/
+void host_irq_set_line(IRQn_Type irq, uint32_t (*line)(void));
+void host_irq_pend(IRQn_Type irq);
+void host_irq_dispatch(void);
+
+
+/* I2C slave devices, attached to I2C1 ---------------------------------------*/
+typedef struct host_i2c_dev host_i2c_dev_t;
+
+struct host_i2c_dev
+{
+	uint8_t		addr;																		// 7-bit address
+	int			(*start)(host_i2c_dev_t *dev, uint8_t read);		// address phase, 0 = ACK
+	void		(*write)(host_i2c_dev_t *dev, const uint8_t *buf, uint16_t len);
+	void		(*read)(host_i2c_dev_t *dev, uint8_t *buf, uint16_t len);
+	host_i2c_dev_t	*next;
+};
+
+void host_i2c_attach(host_i2c_dev_t *dev);
+void host_i2c_detach_all(void);
+
+
+/* USART2 line ---------------------------------------------------------------*/
+#define HOST_UART_ERR_NONE	0x00
+#define HOST_UART_ERR_NE		0x01			// noise on the character
+#define HOST_UART_ERR_FE		0x02			// broken stop bit (collision, line fault)
+
+/* Received character: start bit at t_us, bits data bits at baud */
+void host_uart_rx_char(uint64_t t_us, uint16_t word, uint8_t bits, uint32_t baud, uint8_t err);
+/* Characters back to back from now or after the last queued one */
+void host_uart_rx(const uint8_t *buf, uint16_t len, uint32_t baud);
+void host_uart_rx_words(const uint16_t *buf, uint16_t len, uint8_t bits, uint32_t baud);
+uint64_t host_uart_rx_idle_at(void);
+/* Bus error on a USART2 DMA channel, the channel stops as in hardware */
+void host_dma_error(DMA_Channel_TypeDef *ch);
+
+/* Transmitted characters and driver enable of the node */
+typedef struct
+{
+	void	(*tx_char)(uint64_t t_us, uint16_t word, uint8_t bits, uint32_t baud);	// start bit at t_us
+	void	(*de)(uint64_t t_us, uint8_t on);
+} host_uart_hooks_t;
+
+void host_uart_set_hooks(const host_uart_hooks_t *hooks);
+uint32_t host_uart_baud(void);
+uint8_t host_uart_bits(void);
+uint8_t host_uart_tx_active(void);
+
+
+/* Board, hal handles and MX_xxx_Init() of main.c -----------------------------*/
+extern I2C_HandleTypeDef hi2c1;
+extern UART_HandleTypeDef huart2;
+extern DMA_HandleTypeDef hdma_usart2_rx;
+extern DMA_HandleTypeDef hdma_usart2_tx;
+
+void board_init(void);
+void board_start(void);
+void board_loop(void);
+void board_run_us(uint64_t us);
+
+#endif
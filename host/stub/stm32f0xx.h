@@ -0,0 +1,206 @@
+/**
+  ******************************************************************************
+  * File Name          : stm32f0xx.h
+  * Description        : Host stand-in for the CMSIS device header
+  ******************************************************************************
+  *
+  * Copyright (c) 2016 S54MTB
+  * Licensed under Apache License 2.0
+  * http://www.apache.org/licenses/LICENSE-2.0.html
+  *
+  ******************************************************************************
+
+  Only the registers and bits used by the firmware and the host HAL are
+  here, with the layout and bit positions of STM32F070x6. Peripherals are
+  plain structures updated by the simulator in host.h.
+  */
+#ifndef __STM32F0XX_H
+#define __STM32F0XX_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define __IO			volatile
+#define __weak		__attribute__((weak))
+#define __DMB()		__sync_synchronize()
+
+#define SET_BIT(REG, BIT)			((REG) |= (BIT))
+#define CLEAR_BIT(REG, BIT)		((REG) &= ~(BIT))
+#define READ_BIT(REG, BIT)		((REG) & (BIT))
+#define WRITE_REG(REG, VAL)		((REG) = (VAL))
+#define READ_REG(REG)					((REG))
+#define MODIFY_REG(REG, CLEARMASK, SETMASK)	WRITE_REG((REG), (((READ_REG(REG)) & (~(CLEARMASK))) | (SETMASK)))
+
+/* Core, see hal_core.c */
+void __WFI(void);
+void __disable_irq(void);
+void __enable_irq(void);
+
+typedef enum
+{
+	SysTick_IRQn						= -1,
+	DMA1_Channel4_5_IRQn		= 11,
+	I2C1_IRQn								= 23,
+	USART2_IRQn							= 28,
+} IRQn_Type;
+
+
+/* Peripheral registers ------------------------------------------------------*/
+typedef struct
+{
+	__IO uint32_t CR1, CR2, CR3, BRR, GTPR, RTOR, RQR, ISR, ICR, RDR, TDR;
+} USART_TypeDef;
+
+typedef struct
+{
+	__IO uint32_t CR1, CR2, OAR1, OAR2, TIMINGR, TIMEOUTR, ISR, ICR, PECR, RXDR, TXDR;
+} I2C_TypeDef;
+
+typedef struct
+{
+	__IO uint32_t CCR, CNDTR, CPAR, CMAR, RESERVED;
+} DMA_Channel_TypeDef;
+
+typedef struct
+{
+	__IO uint32_t ISR, IFCR;
+} DMA_TypeDef;
+
+typedef struct
+{
+	__IO uint32_t DR, IDR, CR, RESERVED, INIT, POL;
+} CRC_TypeDef;
+
+typedef struct
+{
+	__IO uint32_t MODER, OTYPER, OSPEEDR, PUPDR, IDR, ODR, BSRR, LCKR, AFR[2], BRR;
+} GPIO_TypeDef;
+
+extern USART_TypeDef				host_usart2;
+extern I2C_TypeDef					host_i2c1;
+extern DMA_TypeDef					host_dma1;
+extern DMA_Channel_TypeDef	host_dma1_channel4, host_dma1_channel5;
+extern CRC_TypeDef					host_crc;
+extern GPIO_TypeDef					host_gpioa, host_gpiof;
+
+#define USART2					(&host_usart2)
+#define I2C1						(&host_i2c1)
+#define DMA1						(&host_dma1)
+#define DMA1_Channel4		(&host_dma1_channel4)
+#define DMA1_Channel5		(&host_dma1_channel5)
+#define CRC							(&host_crc)
+#define GPIOA						(&host_gpioa)
+#define GPIOF						(&host_gpiof)
+
+
+/* USART bits ----------------------------------------------------------------*/
+#define USART_CR1_UE				(1UL << 0)
+#define USART_CR1_RE				(1UL << 2)
+#define USART_CR1_TE				(1UL << 3)
+#define USART_CR1_IDLEIE		(1UL << 4)
+#define USART_CR1_RXNEIE		(1UL << 5)
+#define USART_CR1_TCIE			(1UL << 6)
+#define USART_CR1_TXEIE			(1UL << 7)
+#define USART_CR1_PEIE			(1UL << 8)
+#define USART_CR1_PCE				(1UL << 10)
+#define USART_CR1_WAKE			(1UL << 11)
+#define USART_CR1_M					(1UL << 12)
+#define USART_CR1_MME				(1UL << 13)
+#define USART_CR1_CMIE			(1UL << 14)
+#define USART_CR1_OVER8			(1UL << 15)
+#define USART_CR1_DEDT			(0x1FUL << 16)
+#define USART_CR1_DEAT			(0x1FUL << 21)
+
+#define USART_CR2_ADDM7			(1UL << 4)
+#define USART_CR2_STOP			(3UL << 12)
+#define USART_CR2_ABREN			(1UL << 20)
+#define USART_CR2_ABRMODE		(3UL << 21)
+#define USART_CR2_ABRMODE_0	(1UL << 21)
+#define USART_CR2_ABRMODE_1	(1UL << 22)
+#define USART_CR2_ADD				(0xFFUL << 24)
+
+#define USART_CR3_EIE				(1UL << 0)
+#define USART_CR3_DMAR			(1UL << 6)
+#define USART_CR3_DMAT			(1UL << 7)
+#define USART_CR3_OVRDIS		(1UL << 12)
+#define USART_CR3_DDRE			(1UL << 13)
+#define USART_CR3_DEM				(1UL << 14)
+#define USART_CR3_DEP				(1UL << 15)
+
+#define USART_RQR_ABRRQ			(1UL << 0)
+#define USART_RQR_MMRQ			(1UL << 2)
+#define USART_RQR_RXFRQ			(1UL << 3)
+
+#define USART_ISR_PE				(1UL << 0)
+#define USART_ISR_FE				(1UL << 1)
+#define USART_ISR_NE				(1UL << 2)
+#define USART_ISR_ORE				(1UL << 3)
+#define USART_ISR_IDLE			(1UL << 4)
+#define USART_ISR_RXNE			(1UL << 5)
+#define USART_ISR_TC				(1UL << 6)
+#define USART_ISR_TXE				(1UL << 7)
+#define USART_ISR_ABRE			(1UL << 14)
+#define USART_ISR_ABRF			(1UL << 15)
+#define USART_ISR_BUSY			(1UL << 16)
+#define USART_ISR_CMF				(1UL << 17)
+#define USART_ISR_RWU				(1UL << 19)
+#define USART_ISR_TEACK			(1UL << 21)
+#define USART_ISR_REACK			(1UL << 22)
+
+#define USART_ICR_PECF			(1UL << 0)
+#define USART_ICR_FECF			(1UL << 1)
+#define USART_ICR_NCF				(1UL << 2)
+#define USART_ICR_ORECF			(1UL << 3)
+#define USART_ICR_IDLECF		(1UL << 4)
+#define USART_ICR_TCCF			(1UL << 6)
+#define USART_ICR_CMCF			(1UL << 17)
+
+
+/* I2C bits ------------------------------------------------------------------*/
+#define I2C_CR1_PE					(1UL << 0)
+#define I2C_ISR_TXIS				(1UL << 1)
+#define I2C_ISR_RXNE				(1UL << 2)
+#define I2C_ISR_NACKF				(1UL << 4)
+#define I2C_ISR_STOPF				(1UL << 5)
+#define I2C_ISR_TC					(1UL << 6)
+#define I2C_ISR_BERR				(1UL << 8)
+#define I2C_ISR_ARLO				(1UL << 9)
+#define I2C_ISR_OVR					(1UL << 10)
+#define I2C_ISR_BUSY				(1UL << 15)
+
+
+/* DMA bits ------------------------------------------------------------------*/
+#define DMA_CCR_EN					(1UL << 0)
+#define DMA_CCR_TCIE				(1UL << 1)
+#define DMA_CCR_HTIE				(1UL << 2)
+#define DMA_CCR_TEIE				(1UL << 3)
+#define DMA_CCR_DIR					(1UL << 4)
+#define DMA_CCR_CIRC				(1UL << 5)
+#define DMA_CCR_PINC				(1UL << 6)
+#define DMA_CCR_MINC				(1UL << 7)
+#define DMA_CCR_PSIZE				(3UL << 8)
+#define DMA_CCR_MSIZE				(3UL << 10)
+#define DMA_CCR_PL					(3UL << 12)
+
+#define DMA_ISR_GIF1				(1UL << 0)		// channel n at bit 4*(n-1)
+#define DMA_ISR_TCIF1				(1UL << 1)
+#define DMA_ISR_HTIF1				(1UL << 2)
+#define DMA_ISR_TEIF1				(1UL << 3)
+
+
+/* CRC bits ------------------------------------------------------------------*/
+#define CRC_CR_RESET				(1UL << 0)
+#define CRC_CR_POLYSIZE			(3UL << 3)
+#define CRC_CR_POLYSIZE_0		(1UL << 3)
+#define CRC_CR_POLYSIZE_1		(1UL << 4)
+#define CRC_CR_REV_IN				(3UL << 5)
+#define CRC_CR_REV_OUT			(1UL << 7)
+
+
+/* Node address set at run time, for builds with SETUP_OWNADDRESS=host_node_address */
+extern uint8_t host_node_address;
+
+
+#include "stm32f0xx_hal.h"
+
+#endif
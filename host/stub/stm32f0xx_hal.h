@@ -0,0 +1,439 @@
+/**
+  ******************************************************************************
+  * File Name          : stm32f0xx_hal.h
+  * Description        : Host stand-in for the STM32F0 HAL
+  ******************************************************************************
+  *
+  * Copyright (c) 2016 S54MTB
+  * Licensed under Apache License 2.0
+  * http://www.apache.org/licenses/LICENSE-2.0.html
+  *
+  ******************************************************************************
+
+  Types, constants and macros carry the names and values of the STM32Cube
+  F0 HAL in inc/, so the firmware compiles unchanged. Only the functions
+  used by the firmware are implemented, in hal_*.c. Register writes with
+  side effects in hardware (flag clear, requests, CRC reset) go through
+  the simulator.
+  */
+#ifndef __STM32F0xx_HAL_H
+#define __STM32F0xx_HAL_H
+
+#include "stm32f0xx.h"
+
+typedef enum
+{
+	HAL_OK			= 0x00,
+	HAL_ERROR		= 0x01,
+	HAL_BUSY		= 0x02,
+	HAL_TIMEOUT	= 0x03
+} HAL_StatusTypeDef;
+
+typedef enum
+{
+	HAL_UNLOCKED = 0x00,
+	HAL_LOCKED   = 0x01
+} HAL_LockTypeDef;
+
+typedef enum { RESET = 0, SET = !RESET } FlagStatus, ITStatus;
+
+#define HAL_MAX_DELAY			0xFFFFFFFFU
+
+
+/* Core ----------------------------------------------------------------------*/
+HAL_StatusTypeDef HAL_Init(void);
+void HAL_IncTick(void);
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t Delay);
+void HAL_SYSTICK_IRQHandler(void);
+void HAL_SYSTICK_Callback(void);
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority);
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn);
+void HAL_NVIC_DisableIRQ(IRQn_Type IRQn);
+uint32_t HAL_RCC_GetHCLKFreq(void);
+uint32_t HAL_RCC_GetPCLK1Freq(void);
+
+
+/* GPIO ----------------------------------------------------------------------*/
+typedef enum
+{
+	GPIO_PIN_RESET = 0,
+	GPIO_PIN_SET
+} GPIO_PinState;
+
+typedef struct
+{
+	uint32_t Pin;
+	uint32_t Mode;
+	uint32_t Pull;
+	uint32_t Speed;
+	uint32_t Alternate;
+} GPIO_InitTypeDef;
+
+#define GPIO_PIN_0				((uint16_t)0x0001)
+#define GPIO_PIN_1				((uint16_t)0x0002)
+#define GPIO_PIN_2				((uint16_t)0x0004)
+#define GPIO_PIN_3				((uint16_t)0x0008)
+#define GPIO_PIN_5				((uint16_t)0x0020)
+#define GPIO_PIN_6				((uint16_t)0x0040)
+
+#define GPIO_MODE_OUTPUT_PP		((uint32_t)0x00000001)
+#define GPIO_MODE_AF_PP				((uint32_t)0x00000002)
+#define GPIO_MODE_AF_OD				((uint32_t)0x00000012)
+#define GPIO_NOPULL						((uint32_t)0x00000000)
+#define GPIO_PULLUP						((uint32_t)0x00000001)
+#define GPIO_SPEED_LOW				((uint32_t)0x00000000)
+#define GPIO_SPEED_FREQ_HIGH	((uint32_t)0x00000003)
+
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init);
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+
+
+/* DMA -----------------------------------------------------------------------*/
+typedef enum
+{
+	HAL_DMA_STATE_RESET				= 0x00,
+	HAL_DMA_STATE_READY				= 0x01,
+	HAL_DMA_STATE_READY_HALF	= 0x11,
+	HAL_DMA_STATE_BUSY				= 0x02,
+	HAL_DMA_STATE_TIMEOUT			= 0x03,
+	HAL_DMA_STATE_ERROR				= 0x04,
+} HAL_DMA_StateTypeDef;
+
+#define HAL_DMA_ERROR_NONE		((uint32_t)0x00000000)
+#define HAL_DMA_ERROR_TE			((uint32_t)0x00000001)
+
+typedef struct
+{
+	uint32_t Direction;
+	uint32_t PeriphInc;
+	uint32_t MemInc;
+	uint32_t PeriphDataAlignment;
+	uint32_t MemDataAlignment;
+	uint32_t Mode;
+	uint32_t Priority;
+} DMA_InitTypeDef;
+
+typedef struct __DMA_HandleTypeDef
+{
+	DMA_Channel_TypeDef		*Instance;
+	DMA_InitTypeDef				Init;
+	HAL_LockTypeDef				Lock;
+	__IO HAL_DMA_StateTypeDef	State;
+	void									*Parent;
+	void	(* XferCpltCallback)(struct __DMA_HandleTypeDef *hdma);
+	void	(* XferHalfCpltCallback)(struct __DMA_HandleTypeDef *hdma);
+	void	(* XferErrorCallback)(struct __DMA_HandleTypeDef *hdma);
+	__IO uint32_t					ErrorCode;
+} DMA_HandleTypeDef;
+
+#define DMA_PERIPH_TO_MEMORY		((uint32_t)0x00000000)
+#define DMA_MEMORY_TO_PERIPH		((uint32_t)DMA_CCR_DIR)
+#define DMA_PINC_DISABLE				((uint32_t)0x00000000)
+#define DMA_MINC_ENABLE					((uint32_t)DMA_CCR_MINC)
+#define DMA_PDATAALIGN_BYTE			((uint32_t)0x00000000)
+#define DMA_MDATAALIGN_BYTE			((uint32_t)0x00000000)
+#define DMA_NORMAL							((uint32_t)0x00000000)
+#define DMA_CIRCULAR						((uint32_t)DMA_CCR_CIRC)
+#define DMA_PRIORITY_LOW				((uint32_t)0x00000000)
+#define DMA_PRIORITY_HIGH				((uint32_t)0x00002000)
+
+#define DMA_IT_TC								((uint32_t)DMA_CCR_TCIE)
+#define DMA_IT_HT								((uint32_t)DMA_CCR_HTIE)
+#define DMA_IT_TE								((uint32_t)DMA_CCR_TEIE)
+
+#define __HAL_DMA_GET_COUNTER(__HANDLE__)	((__HANDLE__)->Instance->CNDTR)
+#define __HAL_LINKDMA(__HANDLE__, __PPP_DMA_FIELD_, __DMA_HANDLE_) \
+	do { (__HANDLE__)->__PPP_DMA_FIELD_ = &(__DMA_HANDLE_); (__DMA_HANDLE_).Parent = (__HANDLE__); } while(0)
+
+HAL_StatusTypeDef HAL_DMA_Init(DMA_HandleTypeDef *hdma);
+HAL_StatusTypeDef HAL_DMA_Abort(DMA_HandleTypeDef *hdma);
+void HAL_DMA_IRQHandler(DMA_HandleTypeDef *hdma);
+
+
+/* UART ----------------------------------------------------------------------*/
+typedef enum
+{
+	HAL_UART_STATE_RESET			= 0x00,
+	HAL_UART_STATE_READY			= 0x01,
+	HAL_UART_STATE_BUSY				= 0x02,
+	HAL_UART_STATE_BUSY_TX		= 0x12,
+	HAL_UART_STATE_BUSY_RX		= 0x22,
+	HAL_UART_STATE_BUSY_TX_RX	= 0x32,
+	HAL_UART_STATE_TIMEOUT		= 0x03,
+	HAL_UART_STATE_ERROR			= 0x04
+} HAL_UART_StateTypeDef;
+
+#define HAL_UART_ERROR_NONE		((uint32_t)0x00000000)
+#define HAL_UART_ERROR_PE			((uint32_t)0x00000001)
+#define HAL_UART_ERROR_NE			((uint32_t)0x00000002)
+#define HAL_UART_ERROR_FE			((uint32_t)0x00000004)
+#define HAL_UART_ERROR_ORE		((uint32_t)0x00000008)
+#define HAL_UART_ERROR_DMA		((uint32_t)0x00000010)
+
+typedef struct
+{
+	uint32_t BaudRate;
+	uint32_t WordLength;
+	uint32_t StopBits;
+	uint32_t Parity;
+	uint32_t Mode;
+	uint32_t HwFlowCtl;
+	uint32_t OverSampling;
+	uint32_t OneBitSampling;
+} UART_InitTypeDef;
+
+typedef struct
+{
+	uint32_t AdvFeatureInit;
+	uint32_t TxPinLevelInvert;
+	uint32_t RxPinLevelInvert;
+	uint32_t DataInvert;
+	uint32_t Swap;
+	uint32_t OverrunDisable;
+	uint32_t DMADisableonRxError;
+	uint32_t AutoBaudRateEnable;
+	uint32_t AutoBaudRateMode;
+	uint32_t MSBFirst;
+} UART_AdvFeatureInitTypeDef;
+
+typedef struct
+{
+	USART_TypeDef								*Instance;
+	UART_InitTypeDef						Init;
+	UART_AdvFeatureInitTypeDef	AdvancedInit;
+	uint8_t											*pTxBuffPtr;
+	uint16_t										TxXferSize;
+	uint16_t										TxXferCount;
+	uint8_t											*pRxBuffPtr;
+	uint16_t										RxXferSize;
+	uint16_t										RxXferCount;
+	uint16_t										Mask;
+	DMA_HandleTypeDef						*hdmatx;
+	DMA_HandleTypeDef						*hdmarx;
+	HAL_LockTypeDef							Lock;
+	__IO HAL_UART_StateTypeDef	State;
+	__IO uint32_t								ErrorCode;
+} UART_HandleTypeDef;
+
+#define UART_WORDLENGTH_8B			((uint32_t)0x00000000)
+#define UART_WORDLENGTH_9B			((uint32_t)USART_CR1_M)
+#define UART_STOPBITS_1					((uint32_t)0x00000000)
+#define UART_PARITY_NONE				((uint32_t)0x00000000)
+#define UART_MODE_TX_RX					((uint32_t)(USART_CR1_TE | USART_CR1_RE))
+#define UART_HWCONTROL_NONE			((uint32_t)0x00000000)
+#define UART_OVERSAMPLING_16		((uint32_t)0x00000000)
+#define UART_ONE_BIT_SAMPLE_DISABLE	((uint32_t)0x00000000)
+
+#define UART_ADVFEATURE_NO_INIT								((uint32_t)0x00000000)
+#define UART_ADVFEATURE_AUTOBAUDRATE_INIT			((uint32_t)0x00000040)
+#define UART_ADVFEATURE_AUTOBAUDRATE_DISABLE	((uint32_t)0x00000000)
+#define UART_ADVFEATURE_AUTOBAUDRATE_ENABLE		((uint32_t)USART_CR2_ABREN)
+#define UART_ADVFEATURE_AUTOBAUDRATE_ON0X7FFRAME	((uint32_t)USART_CR2_ABRMODE_1)
+
+#define UART_DE_POLARITY_HIGH						((uint32_t)0x00000000)
+#define UART_WAKEUPMETHOD_ADDRESSMARK		((uint32_t)USART_CR1_WAKE)
+#define UART_ADDRESS_DETECT_7B					((uint32_t)USART_CR2_ADDM7)
+
+#define UART_CR2_ADDRESS_LSB_POS				((uint32_t)24)
+#define UART_CR1_DEAT_ADDRESS_LSB_POS		((uint32_t)21)
+#define UART_CR1_DEDT_ADDRESS_LSB_POS		((uint32_t)16)
+
+#define UART_AUTOBAUD_REQUEST						((uint32_t)USART_RQR_ABRRQ)
+#define UART_MUTE_MODE_REQUEST					((uint32_t)USART_RQR_MMRQ)
+#define UART_RXDATA_FLUSH_REQUEST				((uint32_t)USART_RQR_RXFRQ)
+
+#define UART_FLAG_RWU				USART_ISR_RWU
+#define UART_FLAG_CMF				USART_ISR_CMF
+#define UART_FLAG_ABRF			USART_ISR_ABRF
+#define UART_FLAG_ABRE			USART_ISR_ABRE
+#define UART_FLAG_TXE				USART_ISR_TXE
+#define UART_FLAG_TC				USART_ISR_TC
+#define UART_FLAG_RXNE			USART_ISR_RXNE
+#define UART_FLAG_IDLE			USART_ISR_IDLE
+#define UART_FLAG_ORE				USART_ISR_ORE
+#define UART_FLAG_NE				USART_ISR_NE
+#define UART_FLAG_FE				USART_ISR_FE
+#define UART_FLAG_PE				USART_ISR_PE
+
+/* bits 7..5: CR1/CR2/CR3, bits 4..0: enable bit, bits 15..8: ISR flag */
+#define UART_IT_PE					((uint16_t)0x0028)
+#define UART_IT_TXE					((uint16_t)0x0727)
+#define UART_IT_TC					((uint16_t)0x0626)
+#define UART_IT_RXNE				((uint16_t)0x0525)
+#define UART_IT_IDLE				((uint16_t)0x0424)
+#define UART_IT_CM					((uint16_t)0x112E)
+#define UART_IT_ERR					((uint16_t)0x0060)
+#define UART_IT_ORE					((uint16_t)0x0300)
+#define UART_IT_NE					((uint16_t)0x0200)
+#define UART_IT_FE					((uint16_t)0x0100)
+#define UART_IT_MASK				((uint32_t)0x001F)
+
+#define UART_CLEAR_PEF			USART_ICR_PECF
+#define UART_CLEAR_FEF			USART_ICR_FECF
+#define UART_CLEAR_NEF			USART_ICR_NCF
+#define UART_CLEAR_OREF			USART_ICR_ORECF
+#define UART_CLEAR_IDLEF		USART_ICR_IDLECF
+#define UART_CLEAR_TCF			USART_ICR_TCCF
+#define UART_CLEAR_CMF			USART_ICR_CMCF
+
+void host_usart_icr(USART_TypeDef *usart, uint32_t clear);
+void host_usart_rqr(USART_TypeDef *usart, uint32_t request);
+void host_usart_cr1(USART_TypeDef *usart, uint32_t cr1);
+
+#define __HAL_UART_ENABLE(__HANDLE__)		host_usart_cr1((__HANDLE__)->Instance, (__HANDLE__)->Instance->CR1 | USART_CR1_UE)
+#define __HAL_UART_DISABLE(__HANDLE__)	host_usart_cr1((__HANDLE__)->Instance, (__HANDLE__)->Instance->CR1 & ~USART_CR1_UE)
+#define __HAL_UART_GET_FLAG(__HANDLE__, __FLAG__)	(((__HANDLE__)->Instance->ISR & (__FLAG__)) == (__FLAG__))
+#define __HAL_UART_CLEAR_FLAG(__HANDLE__, __FLAG__)	host_usart_icr((__HANDLE__)->Instance, (__FLAG__))
+#define __HAL_UART_CLEAR_IT(__HANDLE__, __IT_CLEAR__)	host_usart_icr((__HANDLE__)->Instance, (__IT_CLEAR__))
+#define __HAL_UART_SEND_REQ(__HANDLE__, __REQ__)	host_usart_rqr((__HANDLE__)->Instance, (__REQ__))
+#define __HAL_UART_GET_IT(__HANDLE__, __IT__)	((__HANDLE__)->Instance->ISR & ((uint32_t)1 << ((__IT__) >> 0x08)))
+#define __HAL_UART_ENABLE_IT(__HANDLE__, __INTERRUPT__)	\
+	(((((uint8_t)(__INTERRUPT__)) >> 5U) == 1) ? ((__HANDLE__)->Instance->CR1 |= (1U << ((__INTERRUPT__) & UART_IT_MASK))) : \
+	 ((((uint8_t)(__INTERRUPT__)) >> 5U) == 2) ? ((__HANDLE__)->Instance->CR2 |= (1U << ((__INTERRUPT__) & UART_IT_MASK))) : \
+	                                             ((__HANDLE__)->Instance->CR3 |= (1U << ((__INTERRUPT__) & UART_IT_MASK))))
+#define __HAL_UART_DISABLE_IT(__HANDLE__, __INTERRUPT__)	\
+	(((((uint8_t)(__INTERRUPT__)) >> 5U) == 1) ? ((__HANDLE__)->Instance->CR1 &= ~(1U << ((__INTERRUPT__) & UART_IT_MASK))) : \
+	 ((((uint8_t)(__INTERRUPT__)) >> 5U) == 2) ? ((__HANDLE__)->Instance->CR2 &= ~(1U << ((__INTERRUPT__) & UART_IT_MASK))) : \
+	                                             ((__HANDLE__)->Instance->CR3 &= ~(1U << ((__INTERRUPT__) & UART_IT_MASK))))
+#define __HAL_UART_GET_IT_SOURCE(__HANDLE__, __IT__)	\
+	((((((uint8_t)(__IT__)) >> 5U) == 1) ? (__HANDLE__)->Instance->CR1 : \
+	  (((((uint8_t)(__IT__)) >> 5U) == 2) ? (__HANDLE__)->Instance->CR2 : (__HANDLE__)->Instance->CR3)) & \
+	 ((uint32_t)1 << (((uint16_t)(__IT__)) & UART_IT_MASK)))
+
+HAL_StatusTypeDef HAL_RS485Ex_Init(UART_HandleTypeDef *huart, uint32_t Polarity, uint32_t AssertionTime, uint32_t DeassertionTime);
+HAL_StatusTypeDef HAL_MultiProcessor_Init(UART_HandleTypeDef *huart, uint8_t Address, uint32_t WakeUpMethod);
+HAL_StatusTypeDef HAL_MultiProcessorEx_AddressLength_Set(UART_HandleTypeDef *huart, uint32_t AddressLength);
+HAL_StatusTypeDef HAL_MultiProcessor_EnableMuteMode(UART_HandleTypeDef *huart);
+void HAL_MultiProcessor_EnterMuteMode(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_UART_Receive_DMA(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_UART_DMAStop(UART_HandleTypeDef *huart);
+void HAL_UART_IRQHandler(UART_HandleTypeDef *huart);
+void HAL_UART_MspInit(UART_HandleTypeDef *huart);
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart);
+void HAL_UART_TxHalfCpltCallback(UART_HandleTypeDef *huart);
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart);
+void HAL_UART_RxHalfCpltCallback(UART_HandleTypeDef *huart);
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart);
+
+
+/* I2C -----------------------------------------------------------------------*/
+typedef enum
+{
+	HAL_I2C_STATE_RESET			= 0x00,
+	HAL_I2C_STATE_READY			= 0x20,
+	HAL_I2C_STATE_BUSY			= 0x24,
+	HAL_I2C_STATE_BUSY_TX		= 0x21,
+	HAL_I2C_STATE_BUSY_RX		= 0x22,
+	HAL_I2C_STATE_TIMEOUT		= 0xA0,
+	HAL_I2C_STATE_ERROR			= 0xE0
+} HAL_I2C_StateTypeDef;
+
+#define HAL_I2C_ERROR_NONE			((uint32_t)0x00000000)
+#define HAL_I2C_ERROR_BERR			((uint32_t)0x00000001)
+#define HAL_I2C_ERROR_ARLO			((uint32_t)0x00000002)
+#define HAL_I2C_ERROR_AF				((uint32_t)0x00000004)
+#define HAL_I2C_ERROR_OVR				((uint32_t)0x00000008)
+#define HAL_I2C_ERROR_DMA				((uint32_t)0x00000010)
+#define HAL_I2C_ERROR_TIMEOUT		((uint32_t)0x00000020)
+
+typedef struct
+{
+	uint32_t Timing;
+	uint32_t OwnAddress1;
+	uint32_t AddressingMode;
+	uint32_t DualAddressMode;
+	uint32_t OwnAddress2;
+	uint32_t OwnAddress2Masks;
+	uint32_t GeneralCallMode;
+	uint32_t NoStretchMode;
+} I2C_InitTypeDef;
+
+typedef struct
+{
+	I2C_TypeDef									*Instance;
+	I2C_InitTypeDef							Init;
+	uint8_t											*pBuffPtr;
+	uint16_t										XferSize;
+	__IO uint16_t								XferCount;
+	HAL_LockTypeDef							Lock;
+	__IO HAL_I2C_StateTypeDef		State;
+	__IO uint32_t								ErrorCode;
+} I2C_HandleTypeDef;
+
+#define I2C_ADDRESSINGMODE_7BIT		((uint32_t)0x00000001)
+#define I2C_DUALADDRESS_DISABLE		((uint32_t)0x00000000)
+#define I2C_OA2_NOMASK						((uint32_t)0x00000000)
+#define I2C_GENERALCALL_DISABLE		((uint32_t)0x00000000)
+#define I2C_NOSTRETCH_ENABLE			((uint32_t)0x00020000)
+
+#define I2C_FLAG_NACKF			I2C_ISR_NACKF
+#define I2C_FLAG_STOPF			I2C_ISR_STOPF
+#define I2C_FLAG_BERR				I2C_ISR_BERR
+#define I2C_FLAG_ARLO				I2C_ISR_ARLO
+#define I2C_FLAG_OVR				I2C_ISR_OVR
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *hi2c);
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef *hi2c);
+HAL_StatusTypeDef HAL_I2C_Master_Transmit_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_I2C_Master_Receive_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size);
+void HAL_I2C_EV_IRQHandler(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_ER_IRQHandler(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_MasterTxCpltCallback(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_MasterRxCpltCallback(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c);
+
+
+/* CRC -----------------------------------------------------------------------*/
+typedef enum
+{
+	HAL_CRC_STATE_RESET			= 0x00,
+	HAL_CRC_STATE_READY			= 0x01,
+	HAL_CRC_STATE_BUSY			= 0x02,
+	HAL_CRC_STATE_TIMEOUT		= 0x03,
+	HAL_CRC_STATE_ERROR			= 0x04
+} HAL_CRC_StateTypeDef;
+
+typedef struct
+{
+	uint8_t  DefaultPolynomialUse;
+	uint8_t  DefaultInitValueUse;
+	uint32_t GeneratingPolynomial;
+	uint32_t CRCLength;
+	uint32_t InitValue;
+	uint32_t InputDataInversionMode;
+	uint32_t OutputDataInversionMode;
+} CRC_InitTypeDef;
+
+typedef struct
+{
+	CRC_TypeDef									*Instance;
+	CRC_InitTypeDef							Init;
+	HAL_LockTypeDef							Lock;
+	__IO HAL_CRC_StateTypeDef		State;
+	uint32_t										InputDataFormat;
+} CRC_HandleTypeDef;
+
+#define DEFAULT_POLYNOMIAL_ENABLE					((uint8_t)0x00)
+#define DEFAULT_POLYNOMIAL_DISABLE				((uint8_t)0x01)
+#define DEFAULT_INIT_VALUE_ENABLE					((uint8_t)0x00)
+#define DEFAULT_INIT_VALUE_DISABLE				((uint8_t)0x01)
+#define CRC_POLYLENGTH_32B								((uint32_t)0x00000000)
+#define CRC_POLYLENGTH_16B								((uint32_t)CRC_CR_POLYSIZE_0)
+#define CRC_POLYLENGTH_8B									((uint32_t)CRC_CR_POLYSIZE_1)
+#define CRC_POLYLENGTH_7B									((uint32_t)CRC_CR_POLYSIZE)
+#define CRC_INPUTDATA_INVERSION_NONE			((uint32_t)0x00000000)
+#define CRC_OUTPUTDATA_INVERSION_DISABLE	((uint32_t)0x00000000)
+#define CRC_INPUTDATA_FORMAT_BYTES				((uint32_t)0x00000001)
+
+void host_crc_reset(CRC_TypeDef *crc);
+
+#define __HAL_CRC_DR_RESET(__HANDLE__)	host_crc_reset((__HANDLE__)->Instance)
+
+HAL_StatusTypeDef HAL_CRC_Init(CRC_HandleTypeDef *hcrc);
+uint32_t HAL_CRC_Accumulate(CRC_HandleTypeDef *hcrc, uint32_t pBuffer[], uint32_t BufferLength);
+uint32_t HAL_CRC_Calculate(CRC_HandleTypeDef *hcrc, uint32_t pBuffer[], uint32_t BufferLength);
+
+#endif
@@ -0,0 +1,33 @@
+/**
+  ******************************************************************************
+  * File Name          : check.h
+  * Description        : Assertions for host tests
+  ******************************************************************************
+  *
+  * Copyright (c) 2016 S54MTB
+  * Licensed under Apache License 2.0
+  * http://www.apache.org/licenses/LICENSE-2.0.html
+  *
+  ******************************************************************************
+  */
+#ifndef __CHECK_H__
+#define __CHECK_H__
+
+#include <stdio.h>
+
+static int check_failed;
+
+/* Report and count failed condition, the test goes on */
+#define CHECK(cond) \
+	do { \
+		if (!(cond)) \
+		{ \
+			fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+			check_failed++; \
+		} \
+	} while (0)
+
+/* Exit code of the test */
+#define CHECK_RESULT()	(check_failed ? 1 : 0)
+
+#endif
@@ -0,0 +1,149 @@
+/**
+  ******************************************************************************
+  * File Name          : link.c
+  * Description        : Bus master side of the RS485 line for host tests
+  ******************************************************************************
+  *
+  * Copyright (c) 2016 S54MTB
+  * Licensed under Apache License 2.0
+  * http://www.apache.org/licenses/LICENSE-2.0.html
+  *
+  ******************************************************************************
+
+  Frames go to the node over the virtual line at the master rate, with
+  address mark in front when the node runs SETUP_MUTEMODE. Characters
+  sent by the node are captured and decoded back to frames.
+  */
+#include <string.h>
+#include "link.h"
+#include "hdlc.h"
+#include "crc.h"
+#include "setup.h"
+
+static uint32_t link_baud;
+static uint8_t	capture[LINK_CAPTURE];
+static uint16_t	capture_head, capture_tail;
+
+static void link_tx_char(uint64_t t_us, uint16_t word, uint8_t bits, uint32_t baud)
+{
+	if ((uint16_t)(capture_head - capture_tail) < LINK_CAPTURE)
+		capture[capture_head++ % LINK_CAPTURE] = (uint8_t)word;
+}
+
+static const host_uart_hooks_t link_hooks = { link_tx_char, NULL };
+
+
+void link_init(uint32_t baud)
+{
+	link_baud = baud;
+	capture_head = capture_tail = 0;
+	host_uart_set_hooks(&link_hooks);
+}
+
+void link_set_baud(uint32_t baud)
+{
+	link_baud = baud;
+}
+
+uint16_t link_pending(void)
+{
+	return capture_head - capture_tail;
+}
+
+/* Escaped frame with flags and CRC, returns wire length */
+uint16_t link_wire(uint8_t *wire, uint8_t src, uint8_t dest, const uint8_t *payload, uint16_t len)
+{
+	uint8_t frame[HDLC_TX_MTU + 8];
+	uint16_t crc, i, n = 0;
+
+	frame[0] = src;
+	frame[1] = dest;
+	frame[2] = HDLC_UI_CMD | HDLC_POLL_FLAG;
+	memcpy(&frame[3], payload, len);
+	crc = crc16(frame, len + 3);
+	frame[len + 3] = crc >> 8;
+	frame[len + 4] = crc & 0xff;
+
+	wire[n++] = HDLC_FLAG_SOF;
+	for (i=0; i<len+5; i++)
+	{
+		if ((frame[i] == HDLC_FLAG_SOF) || (frame[i] == HDLC_CONTROL_ESCAPE))
+		{
+			wire[n++] = HDLC_CONTROL_ESCAPE;
+			wire[n++] = frame[i] ^ HDLC_ESCAPE_BIT;
+		}
+		else
+			wire[n++] = frame[i];
+	}
+	wire[n++] = HDLC_FLAG_SOF;
+	return n;
+}
+
+void link_send_raw(const uint8_t *wire, uint16_t len)
+{
+	host_uart_rx(wire, len, link_baud);
+}
+
+void link_send(uint8_t dest, const uint8_t *payload, uint16_t len)
+{
+	uint8_t wire[2*HDLC_TX_MTU + 16];
+	uint16_t n = link_wire(wire, LINK_MASTER_ADDR, dest, payload, len);
+#ifdef SETUP_MUTEMODE
+	uint16_t words[2*HDLC_TX_MTU + 17];
+	uint16_t i;
+
+	words[0] = 0x100 | dest;    // address mark
+	for (i=0; i<n; i++)
+		words[i + 1] = wire[i];
+	host_uart_rx_words(words, n + 1, 9, link_baud);
+#else
+	link_send_raw(wire, n);
+#endif
+}
+
+/* Next complete frame sent by the node, CRC checked, returns length without CRC or -1 */
+int link_reply(uint8_t *frame, uint16_t size)
+{
+	uint16_t n = 0, t = capture_tail;
+	uint8_t c, esc = 0;
+
+	while (t != capture_head)
+	{
+		c = capture[t++ % LINK_CAPTURE];
+		if (c == HDLC_FLAG_SOF)
+		{
+			if (n == 0)
+				continue;     // opening flag
+			capture_tail = t;
+			if ((n < 5) || (crc16(frame, n) != CRC16_RESIDUE))
+				return -1;
+			return n - 2;
+		}
+		if (c == HDLC_CONTROL_ESCAPE)
+		{
+			esc = 1;
+			continue;
+		}
+		if (n < size)
+			frame[n++] = esc ? (c ^ HDLC_ESCAPE_BIT) : c;
+		esc = 0;
+	}
+	return -1;     // not complete yet
+}
+
+/* Send request and run the board until the reply is in, -1 on timeout */
+int link_request(uint8_t dest, const uint8_t *payload, uint16_t len, uint8_t *reply, uint16_t size, uint32_t timeout_ms)
+{
+	uint64_t tend;
+	int n;
+
+	link_send(dest, payload, len);
+	tend = host_time_us() + 1000ULL * timeout_ms;
+	while (host_time_us() < tend)
+	{
+		board_loop();
+		if ((n = link_reply(reply, size)) >= 0)
+			return n;
+	}
+	return -1;
+}
@@ -0,0 +1,30 @@
+/**
+  ******************************************************************************
+  * File Name          : link.h
+  * Description        : Bus master side of the RS485 line for host tests
+  ******************************************************************************
+  *
+  * Copyright (c) 2016 S54MTB
+  * Licensed under Apache License 2.0
+  * http://www.apache.org/licenses/LICENSE-2.0.html
+  *
+  ******************************************************************************
+  */
+#ifndef __LINK_H__
+#define __LINK_H__
+
+#include "host.h"
+
+#define LINK_MASTER_ADDR	0x01
+#define LINK_CAPTURE			1024			// characters sent by the node
+
+void link_init(uint32_t baud);
+void link_set_baud(uint32_t baud);
+uint16_t link_wire(uint8_t *wire, uint8_t src, uint8_t dest, const uint8_t *payload, uint16_t len);
+void link_send(uint8_t dest, const uint8_t *payload, uint16_t len);
+void link_send_raw(const uint8_t *wire, uint16_t len);
+int link_reply(uint8_t *frame, uint16_t size);
+int link_request(uint8_t dest, const uint8_t *payload, uint16_t len, uint8_t *reply, uint16_t size, uint32_t timeout_ms);
+uint16_t link_pending(void);
+
+#endif
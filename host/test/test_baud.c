@@ -0,0 +1,76 @@
+/**
+  ******************************************************************************
+  * File Name          : test_baud.c
+  * Description        : CMD_Baud rate change, keepalive and fallback
+  ******************************************************************************
+  *
+  * Copyright (c) 2016 S54MTB
+  * Licensed under Apache License 2.0
+  * http://www.apache.org/licenses/LICENSE-2.0.html
+  *
+  ******************************************************************************
+
+  The node is switched to a higher rate while half an escape sequence is
+  still in its decoder, the first frame at the new rate must be answered.
+  Traffic for other nodes and broadcasts then keep the rate for longer than
+  SETUP_BAUD_TIMEOUT. A silent line makes the node fall back to
+  SETUP_BAUDRATE.
+  */
+#include "check.h"
+#include "link.h"
+#include "hdlc.h"
+#include "setup.h"
+
+#define CMD_ID			0x38
+#define CMD_Baud		0x3c
+#define TEST_BAUD		38400
+
+static uint8_t reply[HDLC_TX_MTU + 2];
+
+
+static int request_id(void)
+{
+	uint8_t req = CMD_ID;
+
+	return link_request(SETUP_OWNADDRESS, &req, 1, reply, sizeof(reply), 100);
+}
+
+int main(void)
+{
+	static const uint8_t escape[2] = { HDLC_FLAG_SOF, HDLC_CONTROL_ESCAPE };
+	uint8_t req[5] = { CMD_Baud, TEST_BAUD & 0xff, (TEST_BAUD >> 8) & 0xff, (TEST_BAUD >> 16) & 0xff, 0 };
+	uint8_t other = CMD_ID;
+	uint32_t t;
+
+	board_init();
+	link_init(SETUP_BAUDRATE);
+	board_start();
+	board_run_us(10000);
+
+	// rate change, noise leaves the decoder in an escape before the switch
+	link_send(SETUP_OWNADDRESS, req, sizeof(req));
+	link_send_raw(escape, sizeof(escape));
+	board_run_us(100000);
+	CHECK(link_reply(reply, sizeof(reply)) == 3 + 6);
+	CHECK(host_uart_baud() == TEST_BAUD);
+	link_set_baud(TEST_BAUD);
+	CHECK(request_id() == 3 + 6);
+
+	// only other nodes, then only broadcasts on the line, the rate is kept
+	for (t=0; t<4*SETUP_BAUD_TIMEOUT; t+=SETUP_BAUD_TIMEOUT/4)
+	{
+		link_send((t < 2*SETUP_BAUD_TIMEOUT) ? SETUP_OWNADDRESS + 1 : HDLC_BROADCAST_ADDR, &other, 1);
+		board_run_us(SETUP_BAUD_TIMEOUT / 4 * 1000UL);
+	}
+	CHECK(link_pending() == 0);
+	CHECK(host_uart_baud() == TEST_BAUD);
+	CHECK(request_id() == 3 + 6);
+
+	// silent line, back to the boot rate
+	board_run_us((SETUP_BAUD_TIMEOUT + 100) * 1000UL);
+	CHECK(host_uart_baud() == SETUP_BAUDRATE);
+	link_set_baud(SETUP_BAUDRATE);
+	CHECK(request_id() == 3 + 6);
+
+	return CHECK_RESULT();
+}
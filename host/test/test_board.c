@@ -0,0 +1,95 @@
+/**
+  ******************************************************************************
+  * File Name          : test_board.c
+  * Description        : Whole firmware on the host target, request and reply
+  ******************************************************************************
+  *
+  * Copyright (c) 2016 S54MTB
+  * Licensed under Apache License 2.0
+  * http://www.apache.org/licenses/LICENSE-2.0.html
+  *
+  ******************************************************************************
+  */
+#include <string.h>
+#include "check.h"
+#include "link.h"
+#include "hdlc.h"
+#include "setup.h"
+
+#define CMD_Temperature	0x30
+#define CMD_ID			0x38
+#define CMD_Stats		0x3b
+#define CMD_Baud		0x3c
+#define CMD_Trigger		0x3d
+#define CMD_Collect		0x3e
+
+int main(void)
+{
+	uint8_t req[HDLC_MAX_REQUEST + 1], reply[HDLC_TX_MTU + 2];
+	uint32_t id;
+	uint8_t cmd;
+	int n;
+
+	board_init();
+	link_init(SETUP_BAUDRATE);
+	board_start();
+	board_run_us(10000);
+
+	// identification, reply goes back to the master
+	req[0] = CMD_ID;
+	n = link_request(SETUP_OWNADDRESS, req, 1, reply, sizeof(reply), 100);
+	CHECK(n == 3 + 6);
+	CHECK(reply[0] == SETUP_OWNADDRESS);
+	CHECK(reply[1] == LINK_MASTER_ADDR);
+	CHECK(reply[2] == (HDLC_UI_CMD | HDLC_FINAL_FLAG));
+	CHECK(reply[3] == CMD_ID);
+	memcpy(&id, &reply[5], 4);   // command echo, one reserved byte, id
+	CHECK(id == UNIQUE_ID);
+
+	// frame for other node and broadcast stay unanswered
+	link_send(SETUP_OWNADDRESS + 1, req, 1);
+	link_send(HDLC_BROADCAST_ADDR, req, 1);
+	board_run_us(100000);
+	CHECK(link_pending() == 0);
+
+	// counters see both own frames and the skipped one
+	req[0] = CMD_Stats;
+	n = link_request(SETUP_OWNADDRESS, req, 1, reply, sizeof(reply), 100);
+	CHECK(n == 3 + 11);
+	CHECK(reply[4] == 3);     // rx_frames: ID, broadcast, Stats
+	CHECK(reply[6] == 1);     // rx_skipped
+
+	// every reply fits the frame slot
+	for (cmd=CMD_Temperature; cmd<=CMD_Collect; cmd++)
+	{
+		if ((cmd == CMD_Trigger) || (cmd == CMD_Baud))
+			continue;
+		req[0] = cmd;
+		n = link_request(SETUP_OWNADDRESS, req, 1, reply, sizeof(reply), 100);
+		CHECK((n > 3) && (n <= 3 + HDLC_MAX_REPLY));
+	}
+
+	// longest request: rate change to the current rate, status and rate come back
+	req[0] = CMD_Baud;
+	req[1] = SETUP_BAUDRATE & 0xff;
+	req[2] = (SETUP_BAUDRATE >> 8) & 0xff;
+	req[3] = (SETUP_BAUDRATE >> 16) & 0xff;
+	req[4] = (SETUP_BAUDRATE >> 24) & 0xff;
+	n = link_request(SETUP_OWNADDRESS, req, HDLC_MAX_REQUEST, reply, sizeof(reply), 100);
+	CHECK(n == 3 + 6);
+	CHECK(reply[4] == HAL_OK);
+	CHECK(memcmp(&reply[5], &req[1], 4) == 0);
+	board_run_us(10000);
+
+	// one byte more does not fit the slot and is dropped
+	req[HDLC_MAX_REQUEST] = 0;
+	link_send(SETUP_OWNADDRESS, req, HDLC_MAX_REQUEST + 1);
+	board_run_us(100000);
+	CHECK(link_pending() == 0);
+	req[0] = CMD_Stats;
+	n = link_request(SETUP_OWNADDRESS, req, 1, reply, sizeof(reply), 100);
+	CHECK(n == 3 + 11);
+	CHECK(reply[8] == 1);     // rx_dropped
+
+	return CHECK_RESULT();
+}
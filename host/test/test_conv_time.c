@@ -0,0 +1,166 @@
+/**
+  ******************************************************************************
+  * File Name          : test_conv_time.c
+  * Description        : Sensor conversion waits against the datasheets
+  ******************************************************************************
+  *
+  * Copyright (c) 2016 S54MTB
+  * Licensed under Apache License 2.0
+  * http://www.apache.org/licenses/LICENSE-2.0.html
+  *
+  ******************************************************************************
+
+  Conversion time tables are compared with the datasheet times, maximums
+  for the MS5637. The HDC1080 datasheet gives typical times only, the
+  rounded waits must cover them. A part slower than typical NACKs the
+  result read, hdc1080_conv_poll() retries it for HDC1080_READY_TIMEOUT ms
+  and test_sensors runs that against a slow part. Then every OSR and
+  resolution is run through the blocking and the polled driver functions,
+  with the conversion started at several points within the HAL tick. The
+  time from the command STOP to the result read is taken on the virtual
+  I2C bus, it must not be shorter than the datasheet time and not more
+  than one tick longer than the rounded wait.
+  */
+#include "check.h"
+#include "host.h"
+#include "MS5637.h"
+#include "hdc1080.h"
+
+#define MS5637_I2C_ADDR			0x76
+#define HDC1080_I2C_ADDR		0x40
+#define TEST_PHASES					10				// start points within the HAL tick
+#define TEST_POLL_US				10				// main loop period while polling
+#define TEST_SLACK_US				600				// I2C transfers and polling on top of the wait
+
+/* Datasheet conversion times in us, MS5637 maximum, HDC1080 typical */
+static const uint16_t ms5637_ds_us[6] = { 540, 1060, 2080, 4130, 8220, 16440 };	// OSR 256 .. 8192
+static const uint16_t hdc1080_t_ds_us[2] = { 6350, 3650 };									// 14, 11 bit
+static const uint16_t hdc1080_rh_ds_us[3] = { 6500, 3850, 2500 };						// 14, 11, 8 bit
+
+static uint64_t t_start;			// STOP of the conversion command
+static uint64_t t_read;				// result read addressed
+static uint8_t reads;
+
+
+/* Devices record command times, everything is ACKed */
+static int dev_start(host_i2c_dev_t *dev, uint8_t read)
+{
+	if (read && (dev->addr == HDC1080_I2C_ADDR) && (reads++ == 0))
+		t_read = host_time_us();
+	return 0;
+}
+
+static void ms5637_write(host_i2c_dev_t *dev, const uint8_t *buf, uint16_t len)
+{
+	if (((buf[0] & 0xe0) == MS5637_CONVERT_D1_BASE) && (reads == 0))    // D1 or D2 conversion
+		t_start = host_time_us();
+	if ((buf[0] == MS5637_ADC_READ) && (reads++ == 0))
+		t_read = host_time_us();
+}
+
+static void hdc1080_write(host_i2c_dev_t *dev, const uint8_t *buf, uint16_t len)
+{
+	if ((len == 1) && (buf[0] == HDC1080_TEMPERATURE))
+		t_start = host_time_us();
+}
+
+static host_i2c_dev_t ms5637_dev = { MS5637_I2C_ADDR, dev_start, ms5637_write, NULL, NULL };
+static host_i2c_dev_t hdc1080_dev = { HDC1080_I2C_ADDR, dev_start, hdc1080_write, NULL, NULL };
+
+
+static void check_wait(uint32_t ds_us, uint8_t wait_ms)
+{
+	uint64_t t = t_read - t_start;
+
+	CHECK(t >= ds_us);
+	CHECK(t <= (wait_ms + 1) * 1000UL + TEST_SLACK_US);
+	if ((t < ds_us) || (t > (wait_ms + 1) * 1000UL + TEST_SLACK_US))
+		fprintf(stderr, "  conversion %u us, waited %u us\n", ds_us, (unsigned)t);
+}
+
+/* Start at phase/TEST_PHASES of a tick */
+static void align(uint8_t phase)
+{
+	uint64_t t = host_time_us();
+
+	host_advance_to(t - t % 1000 + 1000 + phase * (1000 / TEST_PHASES));
+}
+
+static void test_ms5637(uint8_t osr)
+{
+	MS5637_conv_t conv;
+	uint32_t D;
+	uint8_t phase;
+
+	for (phase=0; phase<TEST_PHASES; phase++)
+	{
+		align(phase);
+		reads = 0;
+		CHECK(MS5637_read_ADC_TP(&hi2c1, MS5637_CONVERT_D1_BASE, osr, &D) == HAL_OK);
+		check_wait(ms5637_ds_us[osr >> 1], MS5637_conversion_time(osr));
+
+		// polled sequence, D1 wait is checked, D2 follows the same code
+		align(phase);
+		reads = 0;
+		CHECK(MS5637_conv_start(&hi2c1, &conv, osr) == HAL_OK);
+		while (MS5637_conv_poll(&hi2c1, &conv) == HAL_BUSY)
+			host_advance_us(TEST_POLL_US);
+		CHECK(conv.state == MS5637_CONV_DONE);
+		check_wait(ms5637_ds_us[osr >> 1], MS5637_conversion_time(osr));
+	}
+}
+
+static void test_hdc1080(uint8_t tres, uint8_t rhres)
+{
+	hdc1080_conv_t conv;
+	uint32_t ds = hdc1080_t_ds_us[tres] + hdc1080_rh_ds_us[rhres];
+	uint8_t phase, bat;
+	double t, rh;
+
+	for (phase=0; phase<TEST_PHASES; phase++)
+	{
+		align(phase);
+		reads = 0;
+		CHECK(hdc1080_measure(&hi2c1, tres, rhres, 0, &bat, &t, &rh) == HAL_OK);
+		check_wait(ds, hdc1080_conversion_time(tres, rhres));
+
+		align(phase);
+		reads = 0;
+		CHECK(hdc1080_conv_start(&hi2c1, &conv, tres, rhres, 0) == HAL_OK);
+		while (hdc1080_conv_poll(&hi2c1, &conv) == HAL_BUSY)
+			host_advance_us(TEST_POLL_US);
+		CHECK(conv.state == HDC1080_CONV_DONE);
+		check_wait(ds, hdc1080_conversion_time(tres, rhres));
+	}
+}
+
+int main(void)
+{
+	uint8_t osr, tres, rhres;
+
+	// tables
+	for (osr=MS5637_OSR_256; osr<=MS5637_OSR_8192; osr+=2)
+	{
+		CHECK(MS5637_conversion_time_us(osr) == ms5637_ds_us[osr >> 1]);
+		CHECK(MS5637_conversion_time(osr) * 1000UL >= ms5637_ds_us[osr >> 1]);
+	}
+	CHECK(MS5637_conversion_time_us(MS5637_OSR_8192 + 2) == 0);
+	CHECK(MS5637_conversion_time_us(MS5637_OSR_256 + 1) == 0);
+	for (tres=HDC1080_T_RES_14; tres<=HDC1080_T_RES_11; tres++)
+		for (rhres=HDC1080_RH_RES_14; rhres<=HDC1080_RH_RES8; rhres++)
+			CHECK(hdc1080_conversion_time(tres, rhres) * 1000UL >= hdc1080_t_ds_us[tres] + hdc1080_rh_ds_us[rhres]);
+	CHECK(hdc1080_conversion_time_us(HDC1080_T_RES_11 + 1, HDC1080_RH_RES_14) == 0);
+	CHECK(hdc1080_conversion_time_us(HDC1080_T_RES_14, HDC1080_RH_RES8 + 1) == 0);
+
+	// waits on the bus
+	host_i2c_attach(&ms5637_dev);
+	host_i2c_attach(&hdc1080_dev);
+	board_init();
+	for (osr=MS5637_OSR_256; osr<=MS5637_OSR_8192; osr+=2)
+		test_ms5637(osr);
+	for (tres=HDC1080_T_RES_14; tres<=HDC1080_T_RES_11; tres++)
+		for (rhres=HDC1080_RH_RES_14; rhres<=HDC1080_RH_RES8; rhres++)
+			test_hdc1080(tres, rhres);
+
+	return CHECK_RESULT();
+}
@@ -0,0 +1,87 @@
+/**
+  ******************************************************************************
+  * File Name          : test_crc.c
+  * Description        : CRC16 kernels against bitwise XMODEM reference
+  ******************************************************************************
+  *
+  * Copyright (c) 2016 S54MTB
+  * Licensed under Apache License 2.0
+  * http://www.apache.org/licenses/LICENSE-2.0.html
+  *
+  ******************************************************************************
+
+  Built once per CRC16_KERNEL and CRC16_BACKEND. Every length from 0 to
+  300 bytes at every start alignment must give the bitwise result, also
+  when the block is split for crc16_accumulate() and byte by byte with
+  crc16_update(). With the hardware backend the block functions run on the
+  CRC unit model and crc16_update() in software, so both must agree with
+  the reference and with each other.
+  */
+#include "check.h"
+#include "stm32f0xx.h"
+#include "crc.h"
+#if CRC16_BACKEND == CRC16_BACKEND_HW
+#include "stm32f0xx_hal.h"
+#endif
+
+#define TEST_MAX_LEN	300
+
+static uint16_t crc16_bitwise(uint16_t crc, const uint8_t *p, uint16_t len)
+{
+	uint8_t i;
+
+	while (len--)
+	{
+		crc ^= (uint16_t)(*p++) << 8;
+		for (i=0; i<8; i++)
+			crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+	}
+	return crc;
+}
+
+int main(void)
+{
+	static uint8_t buf[TEST_MAX_LEN + 8];
+	uint32_t seed = 1, i;
+	uint16_t len, align, split, crc, ref;
+
+	for (i=0; i<sizeof(buf); i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		buf[i] = (uint8_t)(seed >> 16);
+	}
+
+	// check value of CRC-16/XMODEM
+	CHECK(crc16((const uint8_t *)"123456789", 9) == 0x31c3);
+	CHECK(crc16(buf, 0) == CRC16_INIT_VAL);
+
+	for (align=0; align<8; align++)
+		for (len=0; len<=TEST_MAX_LEN; len++)
+		{
+			ref = crc16_bitwise(CRC16_INIT_VAL, &buf[align], len);
+			CHECK(crc16(&buf[align], len) == ref);
+
+			split = len / 3;
+			crc = crc16_accumulate(CRC16_INIT_VAL, &buf[align], split);
+			CHECK(crc16_accumulate(crc, &buf[align + split], len - split) == ref);
+
+			crc = CRC16_INIT_VAL;
+			for (i=0; i<len; i++)
+				crc = crc16_update(crc, buf[align + i]);
+			CHECK(crc == ref);
+		}
+
+	// data followed by its CRC, MSB first, leaves the residue
+	crc = crc16(buf, 64);
+	buf[64] = crc >> 8;
+	buf[65] = crc & 0xff;
+	CHECK(crc16(buf, 66) == CRC16_RESIDUE);
+
+#if CRC16_BACKEND == CRC16_BACKEND_HW
+	// results above came from the CRC unit, crc16_update() stayed in software
+	CHECK(CRC->POL == 0x1021);
+	CHECK((CRC->CR & CRC_CR_POLYSIZE) == CRC_POLYLENGTH_16B);
+#endif
+
+	return CHECK_RESULT();
+}
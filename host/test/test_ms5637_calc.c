@@ -0,0 +1,74 @@
+/**
+  ******************************************************************************
+  * File Name          : test_ms5637_calc.c
+  * Description        : Integer MS5637 compensation against the double code
+  ******************************************************************************
+  *
+  * Copyright (c) 2016 S54MTB
+  * Licensed under Apache License 2.0
+  * http://www.apache.org/licenses/LICENSE-2.0.html
+  *
+  ******************************************************************************
+
+  Random calibration sets around the datasheet values and random raw
+  readings. Results inside the operating range must agree with the
+  floating point code within MS5637_CALC_ERR_T and _P. Largest pressure
+  differences are at the cold end, where the second order terms grow
+  with the square of the truncated TEMP.
+  */
+#include <math.h>
+#include <stdlib.h>
+#include "check.h"
+#include "MS5637.h"
+
+#define TEST_SETS						2000000
+#define MS5637_CALC_ERR_T		1					// 0.01 degC
+#define MS5637_CALC_ERR_P		11				// 0.01 mbar (Pa)
+
+HAL_StatusTypeDef MS5637_Calculate_ref(uint16_t *C, uint32_t D1, uint32_t D2, double *Temperature, double *Pressure);
+
+static uint32_t seed = 1;
+
+static uint32_t test_rand(uint32_t range)
+{
+	seed = seed * 1664525 + 1013904223;
+	return (uint32_t)(((uint64_t)(seed >> 8) * range) >> 24);
+}
+
+int main(void)
+{
+	static const uint16_t Cds[8] = { 0, 46372, 43981, 29059, 27842, 31553, 28165, 0 };
+	uint16_t C[8];
+	uint32_t D1, D2, i, k, n = 0;
+	int32_t T, P;
+	double Td, Pd, dT, dP, maxT = 0, maxP = 0;
+	HAL_StatusTypeDef ei, ed;
+
+	// datasheet example: 20.00 degC, 1100.02 mbar
+	CHECK(MS5637_Calculate_int(Cds, 6465444, 8077636, &T, &P) == HAL_OK);
+	CHECK(T == 2000);
+	CHECK(P == 110002);
+
+	for (i=0; i<TEST_SETS; i++)
+	{
+		for (k=1; k<7; k++)
+			C[k] = Cds[k] + test_rand(24001) - 12000;
+		D1 = test_rand(1 << 24);
+		D2 = test_rand(1 << 24);
+		ei = MS5637_Calculate_int(C, D1, D2, &T, &P);
+		ed = MS5637_Calculate_ref(C, D1, D2, &Td, &Pd);
+		if ((ei != HAL_OK) || (ed != HAL_OK))
+			continue;
+		n++;
+		dT = fabs(T - 100.0 * Td);
+		dP = fabs(P - 100.0 * Pd);
+		if (dT > maxT) maxT = dT;
+		if (dP > maxP) maxP = dP;
+	}
+	printf("%u sets in range, max. difference %.2f LSB temperature, %.2f Pa pressure\n", n, maxT, maxP);
+	CHECK(n > TEST_SETS / 20);
+	CHECK(maxT <= MS5637_CALC_ERR_T);
+	CHECK(maxP <= MS5637_CALC_ERR_P);
+
+	return CHECK_RESULT();
+}
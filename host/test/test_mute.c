@@ -0,0 +1,87 @@
+/**
+  ******************************************************************************
+  * File Name          : test_mute.c
+  * Description        : Mute mode address filtering on the host target
+  ******************************************************************************
+  *
+  * Copyright (c) 2016 S54MTB
+  * Licensed under Apache License 2.0
+  * http://www.apache.org/licenses/LICENSE-2.0.html
+  *
+  ******************************************************************************
+
+  Built with SETUP_MUTEMODE and node address 0x7D, the HDLC control escape.
+  The address mark character that wakes the receiver lands in the DMA ring
+  in front of the opening flag. If it reached the decoder, it would escape
+  the flag and break every frame after the first one. The receiver is muted
+  again on the idle line after a frame, so pipelined frames are sent with
+  the idle gap setup.h asks for between them.
+  */
+#include "check.h"
+#include "link.h"
+#include "hdlc.h"
+#include "setup.h"
+
+#define CMD_ID			0x38
+#define CMD_Stats		0x3b
+#define TEST_CHAR_US	((11 * 1000000UL + SETUP_BAUDRATE - 1) / SETUP_BAUDRATE)	// 9 bit word
+
+
+/* Request behind its address mark from t0 on, returns end of the last character */
+static uint64_t send_at(uint64_t t0, uint8_t dest, uint8_t cmd)
+{
+	uint8_t wire[16];
+	uint16_t n, i;
+
+	n = link_wire(wire, LINK_MASTER_ADDR, dest, &cmd, 1);
+	host_uart_rx_char(t0, 0x100 | dest, 9, SETUP_BAUDRATE, HOST_UART_ERR_NONE);
+	for (i=0; i<n; i++)
+		host_uart_rx_char(t0 + (i + 1) * TEST_CHAR_US, wire[i], 9, SETUP_BAUDRATE, HOST_UART_ERR_NONE);
+	return t0 + (n + 1) * TEST_CHAR_US;
+}
+
+int main(void)
+{
+	uint8_t req, reply[HDLC_TX_MTU + 2];
+	uint64_t t;
+	uint8_t i;
+
+	board_init();
+	link_init(SETUP_BAUDRATE);
+	board_start();
+	board_run_us(10000);
+
+	// request and reply round trips, each request behind its own address mark
+	req = CMD_ID;
+	for (i=0; i<4; i++)
+		CHECK(link_request(SETUP_OWNADDRESS, &req, 1, reply, sizeof(reply), 100) == 3 + 6);
+
+	// other node, receiver stays muted and the decoder sees nothing
+	link_send(SETUP_OWNADDRESS - 1, &req, 1);
+	board_run_us(50000);
+	CHECK(link_pending() == 0);
+
+	req = CMD_Stats;
+	CHECK(link_request(SETUP_OWNADDRESS, &req, 1, reply, sizeof(reply), 100) == 3 + 11);
+	CHECK(reply[4] == 5);     // rx_frames: 4 x ID, Stats
+	CHECK(reply[6] == 0);     // rx_skipped
+	CHECK(reply[8] == 0);     // rx_dropped
+	CHECK(reply[10] == 0);    // rx_crc_errors
+
+	// pipelined, other node's frame and ours right behind it without gap
+	t = send_at(host_time_us(), SETUP_OWNADDRESS - 1, CMD_ID);
+	send_at(t, SETUP_OWNADDRESS, CMD_ID);
+	board_run_us(100000);
+	CHECK(link_reply(reply, sizeof(reply)) == 3 + 6);
+	CHECK(link_pending() == 0);
+
+	// pipelined, two frames for us with the idle gap of setup.h
+	t = send_at(host_time_us(), SETUP_OWNADDRESS, CMD_ID);
+	send_at(t + 2 * TEST_CHAR_US, SETUP_OWNADDRESS, CMD_ID);
+	board_run_us(100000);
+	CHECK(link_reply(reply, sizeof(reply)) == 3 + 6);
+	CHECK(link_reply(reply, sizeof(reply)) == 3 + 6);
+	CHECK(link_pending() == 0);
+
+	return CHECK_RESULT();
+}
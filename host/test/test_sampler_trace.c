@@ -0,0 +1,100 @@
+/**
+  ******************************************************************************
+  * File Name          : test_sampler_trace.c
+  * Description        : Timing trace of the sampler cycle on the host target
+  ******************************************************************************
+  *
+  * Copyright (c) 2016 S54MTB
+  * Licensed under Apache License 2.0
+  * http://www.apache.org/licenses/LICENSE-2.0.html
+  *
+  ******************************************************************************
+
+  Built with SAMPLER_TRACE_HOOK, the firmware reports the acquisition cycle
+  events, they are stamped with the virtual clock and printed. The HDC1080
+  and MS5637 parts of a cycle must run side by side on the sensor models:
+  both start with the cycle and the cycle takes about the longer part, not
+  the sum of both. A slow HDC1080 does not hold up the MS5637 either.
+  */
+#include "check.h"
+#include "host.h"
+#include "sampler.h"
+#include "sensor_sim.h"
+
+#define TEST_TRACE_LEN		32
+#define TEST_SLACK_US			1000				// tick phase of the last poll
+
+static const char *trace_names[] = {
+	"cycle start", "HDC1080 start", "HDC1080 done", "MS5637 start", "MS5637 done", "cycle done"
+};
+
+static sim_ms5637_t ms5637;
+static sim_hdc1080_t hdc1080;
+static uint64_t trace_t[TEST_TRACE_LEN];
+static sampler_trace_event_t trace_ev[TEST_TRACE_LEN];
+static uint8_t trace_len;
+
+
+void sampler_trace_hook(sampler_trace_event_t event)
+{
+	if (trace_len < TEST_TRACE_LEN)
+	{
+		trace_t[trace_len] = host_time_us();
+		trace_ev[trace_len++] = event;
+	}
+}
+
+/* Time of the first event ev in the trace */
+static uint64_t trace_at(sampler_trace_event_t ev)
+{
+	uint8_t i;
+
+	for (i=0; i<trace_len; i++)
+		if (trace_ev[i] == ev)
+			return trace_t[i];
+	CHECK(0);
+	return 0;
+}
+
+/* One background cycle from the trace start, printed and checked */
+static void test_cycle(void)
+{
+	uint64_t t0, hdc, ms, cycle, longer;
+	uint8_t i;
+
+	trace_len = 0;
+	while ((trace_len == 0) || (trace_ev[trace_len - 1] != SAMPLER_TRACE_CYCLE_DONE))
+		board_loop();
+
+	t0 = trace_at(SAMPLER_TRACE_CYCLE_START);
+	for (i=0; i<trace_len; i++)
+		printf("  %8.3f ms  %s\n", (trace_t[i] - t0) / 1000.0, trace_names[trace_ev[i]]);
+	hdc = trace_at(SAMPLER_TRACE_HDC1080_DONE) - trace_at(SAMPLER_TRACE_HDC1080_START);
+	ms = trace_at(SAMPLER_TRACE_MS5637_DONE) - trace_at(SAMPLER_TRACE_MS5637_START);
+	cycle = trace_at(SAMPLER_TRACE_CYCLE_DONE) - t0;
+	longer = (hdc > ms) ? hdc : ms;
+	printf("  HDC1080 %.3f ms + MS5637 %.3f ms in a %.3f ms cycle\n", hdc / 1000.0, ms / 1000.0, cycle / 1000.0);
+
+	CHECK(trace_at(SAMPLER_TRACE_HDC1080_START) - t0 < TEST_SLACK_US);
+	CHECK(trace_at(SAMPLER_TRACE_MS5637_START) - t0 < TEST_SLACK_US);
+	CHECK(cycle <= longer + TEST_SLACK_US);
+	CHECK(cycle + TEST_SLACK_US < hdc + ms);
+	CHECK(sampler_snapshot()->valid == (SAMPLER_VALID_HDC1080 | SAMPLER_VALID_MS5637));
+}
+
+int main(void)
+{
+	board_init();
+	sim_ms5637_init(&ms5637, NULL);
+	sim_hdc1080_init(&hdc1080);
+	board_start();
+
+	printf("Sampler cycle, datasheet parts\n");
+	test_cycle();
+
+	printf("Sampler cycle, HDC1080 %u ms slow\n", HDC1080_READY_TIMEOUT - 1);
+	hdc1080.extra_us = 1000UL * (HDC1080_READY_TIMEOUT - 1);
+	test_cycle();
+
+	return CHECK_RESULT();
+}
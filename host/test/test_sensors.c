@@ -0,0 +1,135 @@
+/**
+  ******************************************************************************
+  * File Name          : test_sensors.c
+  * Description        : Drivers and sampler on the MS5637 and HDC1080 models
+  ******************************************************************************
+  *
+  * Copyright (c) 2016 S54MTB
+  * Licensed under Apache License 2.0
+  * http://www.apache.org/licenses/LICENSE-2.0.html
+  *
+  ******************************************************************************
+
+  The firmware boots against the sensor models of sim/. Calibration with
+  CRC4, IDs and a background sample set must come through with the values
+  of the models. An HDC1080 that converts slower than typical is NACKed
+  for up to HDC1080_READY_TIMEOUT ms, the driver may retry once per tick
+  only. On demand measurements with a latency budget must then answer
+  within the budget, the slow part included. Raw results out of the
+  sensor range must not be marked valid.
+  */
+#include "check.h"
+#include "link.h"
+#include "hdlc.h"
+#include "setup.h"
+#include "sensor_sim.h"
+#include "sampler.h"
+
+#define CMD_Temperature		0x30
+#define CMD_Humidity			0x31
+#define CMD_COMPACT				0x80
+#define TEST_DECODE_US		2000			// request end to hdlc_process(), idle line and loop
+
+static sim_ms5637_t ms5637;
+static sim_hdc1080_t hdc1080;
+static uint8_t reply[HDLC_TX_MTU + 2];
+
+
+/* Request with budget answered within it, fresh and without NACK storm */
+static void test_budget(uint8_t cmd, uint8_t budget)
+{
+	uint8_t req[2] = { cmd | CMD_COMPACT, budget };
+	uint32_t nacks = hdc1080.nacks;
+	uint64_t t0, t;
+
+	link_send(SETUP_OWNADDRESS, req, sizeof(req));
+	t0 = host_uart_rx_idle_at();
+	while ((link_pending() == 0) && (host_time_us() < t0 + 1000ULL * (budget + 100)))
+		board_loop();
+	t = host_time_us() - t0;
+	CHECK(t <= 1000UL * budget + TEST_DECODE_US);
+	if (t > 1000UL * budget + TEST_DECODE_US)
+		fprintf(stderr, "  cmd 0x%02x budget %u ms, reply after %u us\n", cmd, budget, (unsigned)t);
+	board_run_us(20000);
+	CHECK(link_reply(reply, sizeof(reply)) == 3 + 7);
+	CHECK((reply[8] == 0) && (reply[9] == 0));      // fresh
+	CHECK(hdc1080.nacks - nacks <= HDC1080_READY_TIMEOUT + 1);
+}
+
+int main(void)
+{
+	const sampler_snapshot_t *s;
+	const MS5637_cal_t *cal;
+	uint64_t serial;
+	uint16_t manuf, device;
+	uint8_t bat, budget;
+	double t, rh;
+
+	board_init();
+	sim_ms5637_init(&ms5637, NULL);
+	sim_hdc1080_init(&hdc1080);
+	link_init(SETUP_BAUDRATE);
+	board_start();
+
+	// PROM read after the reload time, CRC4 of the model accepted
+	cal = sampler_calibration();
+	CHECK(cal->valid);
+	CHECK(cal->C[1] == 46372);
+	CHECK(cal->C[6] == 28165);
+	CHECK(MS5637_checkCRC4(cal->C) == (cal->C[0] >> 12));
+	CHECK(ms5637.nacks == 0);
+
+	CHECK(hdc1080_get_device_id(&hi2c1, &serial, &manuf, &device) == HAL_OK);
+	CHECK(manuf == 0x5449);
+	CHECK(device == 0x1050);
+
+	// background sample set, both conversions overlap
+	board_run_us(50000);
+	s = sampler_snapshot();
+	CHECK(s->valid == (SAMPLER_VALID_HDC1080 | SAMPLER_VALID_MS5637));
+	CHECK(s->pTemperature == 2000);
+	CHECK(s->pressure == 110002);
+	CHECK(s->temperature == hdc1080_temperature(hdc1080.temperature));
+	CHECK(s->humidity == 5000);
+	CHECK(ms5637.conversions == 2);
+	CHECK(ms5637.adc_early == 0);
+	CHECK(hdc1080.nacks == 0);
+
+	// slow part, NACKed reads once per tick at most
+	hdc1080.extra_us = 1000UL * HDC1080_READY_TIMEOUT - 300;
+	hdc1080.nacks = 0;
+	CHECK(hdc1080_measure(&hi2c1, HDC1080_T_RES_14, HDC1080_RH_RES_14, 0, &bat, &t, &rh) == HAL_OK);
+	CHECK(hdc1080.nacks >= 1);
+	CHECK(hdc1080.nacks <= HDC1080_READY_TIMEOUT + 1);
+	CHECK((rh > 49.9) && (rh < 50.1));
+
+	// slower than the driver waits
+	hdc1080.extra_us = 1000UL * (HDC1080_READY_TIMEOUT + 2);
+	hdc1080.nacks = 0;
+	CHECK(hdc1080_measure(&hi2c1, HDC1080_T_RES_14, HDC1080_RH_RES_14, 0, &bat, &t, &rh) == HAL_ERROR);
+	CHECK(hdc1080.nacks <= HDC1080_READY_TIMEOUT + 2);
+	host_advance_us(10000);
+
+	// on demand within budget, slow part and background cycle running
+	hdc1080.extra_us = 1000UL * HDC1080_READY_TIMEOUT - 300;
+	for (budget=14; budget<=40; budget+=2)
+	{
+		test_budget(CMD_Temperature, budget);
+		test_budget(CMD_Humidity, budget);
+		board_run_us(budget * 397UL);   // other phase of the background cycle next time
+	}
+
+	// results outside the sensor range are not valid in the snapshot
+	ms5637.D1 = 0;
+	board_run_us(1000UL * (SETUP_SAMPLE_PERIOD + 100));
+	CHECK(sampler_snapshot()->valid == SAMPLER_VALID_HDC1080);
+	ms5637.D1 = 6465444;
+	ms5637.D2 = 0;
+	board_run_us(1000UL * SETUP_SAMPLE_PERIOD);
+	CHECK(sampler_snapshot()->valid == SAMPLER_VALID_HDC1080);
+	ms5637.D2 = 8077636;
+	board_run_us(1000UL * SETUP_SAMPLE_PERIOD);
+	CHECK(sampler_snapshot()->valid == (SAMPLER_VALID_HDC1080 | SAMPLER_VALID_MS5637));
+
+	return CHECK_RESULT();
+}
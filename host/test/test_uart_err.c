@@ -0,0 +1,108 @@
+/**
+  ******************************************************************************
+  * File Name          : test_uart_err.c
+  * Description        : Reception goes on after line and DMA errors
+  ******************************************************************************
+  *
+  * Copyright (c) 2016 S54MTB
+  * Licensed under Apache License 2.0
+  * http://www.apache.org/licenses/LICENSE-2.0.html
+  *
+  ******************************************************************************
+
+  Characters with framing error and noise are put on the line inside a
+  request, then a bus error stops the receive DMA channel. After each the
+  circular reception must still run with huart2 in BUSY_RX and the next
+  request must be answered. The same holds after a reply whose transfer
+  complete interrupt is lost, the transmitter must not stay HAL_BUSY.
+  */
+#include <string.h>
+#include "check.h"
+#include "link.h"
+#include "hdlc.h"
+#include "setup.h"
+
+#define CMD_ID			0x38
+#define CMD_Stats		0x3b
+
+static uint8_t reply[HDLC_TX_MTU + 2];
+
+
+/* Request with error flags on wire character k, data corrupted as well on FE */
+static void send_bad(uint8_t cmd, uint16_t k, uint8_t err)
+{
+	uint8_t wire[32];
+	uint16_t n, i;
+	uint64_t t0 = host_uart_rx_idle_at();
+
+	if (t0 < host_time_us())
+		t0 = host_time_us();
+	n = link_wire(wire, LINK_MASTER_ADDR, SETUP_OWNADDRESS, &cmd, 1);
+	for (i=0; i<n; i++)
+		host_uart_rx_char(t0 + ((uint64_t)i * 10 * 1000000UL + SETUP_BAUDRATE - 1) / SETUP_BAUDRATE,
+		                  (i == k) && (err & HOST_UART_ERR_FE) ? wire[i] ^ 0x10 : wire[i], 8,
+		                  SETUP_BAUDRATE, (i == k) ? err : HOST_UART_ERR_NONE);
+}
+
+/* Receiver still running and next request answered */
+static void check_rx_alive(void)
+{
+	uint8_t req = CMD_ID;
+
+	CHECK(huart2.State == HAL_UART_STATE_BUSY_RX);
+	CHECK(huart2.ErrorCode == HAL_UART_ERROR_NONE);
+	CHECK((huart2.Instance->ISR & (USART_ISR_FE | USART_ISR_NE | USART_ISR_ORE)) == 0);
+	CHECK(DMA1_Channel5->CCR & DMA_CCR_EN);
+	CHECK(link_request(SETUP_OWNADDRESS, &req, 1, reply, sizeof(reply), 100) == 3 + 6);
+}
+
+int main(void)
+{
+	uint8_t req = CMD_ID;
+
+	board_init();
+	link_init(SETUP_BAUDRATE);
+	board_start();
+	board_run_us(10000);
+
+	// framing error inside the request, frame is lost to the CRC check
+	send_bad(CMD_ID, 4, HOST_UART_ERR_FE);
+	board_run_us(50000);
+	CHECK(link_pending() == 0);
+	check_rx_alive();
+
+	// noise flag only, the character itself was sampled right
+	send_bad(CMD_ID, 4, HOST_UART_ERR_NE);
+	board_run_us(50000);
+	CHECK(link_reply(reply, sizeof(reply)) == 3 + 6);
+	check_rx_alive();
+
+	// framing error on a CRC byte
+	send_bad(CMD_ID, 6, HOST_UART_ERR_FE);
+	board_run_us(50000);
+	check_rx_alive();
+
+	// transfer complete interrupt of the reply lost, HAL left in BUSY_TX_RX
+	board_run_us(20000);
+	link_send(SETUP_OWNADDRESS, &req, 1);
+	while (!host_uart_tx_active() && (host_time_us() < host_uart_rx_idle_at() + 100000ULL))
+		board_loop();
+	DMA1_Channel4->CCR &= ~DMA_IT_TC;
+	board_run_us(50000);
+	CHECK(link_reply(reply, sizeof(reply)) == 3 + 6);
+	CHECK(huart2.State == HAL_UART_STATE_BUSY_TX_RX);
+	CHECK(link_request(SETUP_OWNADDRESS, &req, 1, reply, sizeof(reply), 100) == 3 + 6);
+	board_run_us(20000);
+	check_rx_alive();
+
+	// receive DMA channel stopped by a bus error
+	host_dma_error(DMA1_Channel5);
+	board_run_us(1000);
+	check_rx_alive();
+
+	req = CMD_Stats;
+	CHECK(link_request(SETUP_OWNADDRESS, &req, 1, reply, sizeof(reply), 100) == 3 + 11);
+	CHECK(reply[10] >= 1);    // rx_crc_errors
+
+	return CHECK_RESULT();
+}
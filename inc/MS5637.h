@@ -17,11 +17,46 @@
 #define MS5637_ADC_READ				  0x00
 #define MS5637_PROM_READ			  0xA0
 
+/* Calibration coefficients cache */
+typedef struct
+{
+	uint16_t	C[8];		// PROM words C0..C7, C0 holds CRC4 and factory data
+	uint8_t		valid;	// 1 when C[] was read and CRC4 checked
+} MS5637_cal_t;
+
+/* D1/D2 conversion sequence state */
+typedef enum
+{
+	MS5637_CONV_IDLE,
+	MS5637_CONV_D1,				// pressure conversion running
+	MS5637_CONV_D2,				// temperature conversion running
+	MS5637_CONV_DONE,			// D1 and D2 available
+	MS5637_CONV_ERROR,
+} MS5637_conv_state_t;
+
+typedef struct
+{
+	MS5637_conv_state_t	state;
+	uint8_t		osr;
+	uint32_t	tstart;			// HAL tick when running conversion was started
+	uint32_t	D1;					// raw pressure
+	uint32_t	D2;					// raw temperature
+} MS5637_conv_t;
+
 
 HAL_StatusTypeDef MS5637_reset(I2C_HandleTypeDef *hi2c);
 HAL_StatusTypeDef MS5637_read_PROM(I2C_HandleTypeDef *hi2c, uint8_t addr, uint16_t *val);
+HAL_StatusTypeDef MS5637_read_calibration(I2C_HandleTypeDef *hi2c, MS5637_cal_t *cal);
+void MS5637_invalidate_calibration(MS5637_cal_t *cal);
+uint16_t MS5637_conversion_time_us(uint8_t osr);
+uint8_t MS5637_conversion_time(uint8_t osr);
+HAL_StatusTypeDef MS5637_start_ADC(I2C_HandleTypeDef *hi2c, uint8_t channel, uint8_t osr);
+HAL_StatusTypeDef MS5637_read_ADC(I2C_HandleTypeDef *hi2c, uint32_t *val);
 HAL_StatusTypeDef MS5637_read_ADC_TP(I2C_HandleTypeDef *hi2c, uint8_t channel, uint8_t osr, uint32_t *val);
+HAL_StatusTypeDef MS5637_conv_start(I2C_HandleTypeDef *hi2c, MS5637_conv_t *conv, uint8_t osr);
+HAL_StatusTypeDef MS5637_conv_poll(I2C_HandleTypeDef *hi2c, MS5637_conv_t *conv);
+HAL_StatusTypeDef MS5637_Calculate_int(const uint16_t *C, uint32_t D1, uint32_t D2, int32_t *Temperature, int32_t *Pressure);
 HAL_StatusTypeDef MS5637_Calculate(uint16_t *C, uint32_t D1, uint32_t D2, double *Temperature, double *Pressure);
-unsigned char MS5637_checkCRC4(uint16_t * C);
+unsigned char MS5637_checkCRC4(const uint16_t * C);
 
 #endif
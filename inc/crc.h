@@ -3,7 +3,45 @@
 
 #ifndef ___crc_h___
 #define ___crc_h___
-uint16_t crc16(const uint8_t *data_p, uint8_t length);
+
+#define CRC16_INIT_VAL		0x0000		// CRC16 XMODEM start value
+#define CRC16_RESIDUE			0x0000		// CRC over data followed by its CRC (MSB first)
+
+/* 
+ * CRC16 kernel, select with -DCRC16_KERNEL=x
+ *  CRC16_KERNEL_TABLE   one byte per step, 512 bytes flash (default)
+ *  CRC16_KERNEL_NIBBLE  4 bits per step, 32 bytes flash, for small targets
+ *  CRC16_KERNEL_SLICE4  4 bytes per step, 1.5 kB RAM tables built on first use
+ *  CRC16_KERNEL_SLICE8  8 bytes per step, 3.5 kB RAM, for host side gateways
+ * Slice kernels use the 512 bytes flash table as well.
+ * All kernels give bit identical results.
+ */
+#define CRC16_KERNEL_TABLE		0
+#define CRC16_KERNEL_NIBBLE		1
+#define CRC16_KERNEL_SLICE4		4
+#define CRC16_KERNEL_SLICE8		8
+
+#ifndef CRC16_KERNEL
+#define CRC16_KERNEL			CRC16_KERNEL_TABLE
+#endif
+
+/* 
+ * Backend for block CRC (crc16, crc16_accumulate), select with -DCRC16_BACKEND=x
+ *  CRC16_BACKEND_SW  software kernel above, also for host builds (default)
+ *  CRC16_BACKEND_HW  CRC unit, only parts with programmable polynomial 
+ *                    (STM32F071/072/078/091/098), main loop use only
+ * crc16_update() is always software, it runs in the receive interrupt.
+ */
+#define CRC16_BACKEND_SW		0
+#define CRC16_BACKEND_HW		1
+
+#ifndef CRC16_BACKEND
+#define CRC16_BACKEND			CRC16_BACKEND_SW
+#endif
+
+uint16_t crc16(const uint8_t *data_p, uint16_t length);
+uint16_t crc16_accumulate(uint16_t crc, const uint8_t *data_p, uint16_t length);
+uint16_t crc16_update(uint16_t crc, uint8_t byte);
 
 
 #endif
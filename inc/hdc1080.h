@@ -21,9 +21,37 @@
 #define HDC1080_T_RES_14					0x00
 #define HDC1080_T_RES_11					0x01 
 
+#define HDC1080_READY_TIMEOUT			5				// ms of NACKed result reads after conversion time
+
+/* Combined temperature and humidity acquisition state */
+typedef enum
+{
+	HDC1080_CONV_IDLE,
+	HDC1080_CONV_BUSY,					// conversion running
+	HDC1080_CONV_DONE,					// results available
+	HDC1080_CONV_ERROR,
+} hdc1080_conv_state_t;
+
+typedef struct
+{
+	hdc1080_conv_state_t	state;
+	uint8_t		tconv;						// conversion time in ms
+	uint32_t	tstart;						// HAL tick when conversion was triggered
+	uint32_t	tretry;						// HAL tick of the last NACKed result read
+	uint16_t	temperature;			// raw temperature
+	uint16_t	humidity;					// raw humidity
+	uint8_t		bat_stat;					// 1 when Ucc < 2,8V
+} hdc1080_conv_t;
+
 
 HAL_StatusTypeDef hdc1080_read_reg(I2C_HandleTypeDef *hi2c, uint16_t delay, uint8_t reg, uint16_t *val);
 HAL_StatusTypeDef hdc1080_write_reg(I2C_HandleTypeDef *hi2c, uint8_t reg, uint16_t val);
+uint16_t hdc1080_conversion_time_us(uint8_t temp_res, uint8_t humidres);
+uint8_t hdc1080_conversion_time(uint8_t temp_res, uint8_t humidres);
+int16_t hdc1080_temperature(uint16_t raw);
+uint16_t hdc1080_humidity(uint16_t raw);
+HAL_StatusTypeDef hdc1080_conv_start(I2C_HandleTypeDef *hi2c, hdc1080_conv_t *conv, uint8_t temp_res, uint8_t humidres, uint8_t heater);
+HAL_StatusTypeDef hdc1080_conv_poll(I2C_HandleTypeDef *hi2c, hdc1080_conv_t *conv);
 HAL_StatusTypeDef hdc1080_measure(I2C_HandleTypeDef *hi2c,   uint8_t temp_res, uint8_t humidres, uint8_t heater, 	uint8_t *bat_stat, double *temperature,	double *humidity);
 HAL_StatusTypeDef hdc1080_get_device_id(I2C_HandleTypeDef *hi2c, uint64_t *serial, uint16_t *manuf, uint16_t *device);
 
@@ -14,23 +14,31 @@
 #ifndef __HDLC_H__
 #define __HDLC_H__
 
-#define HDLC_MRU    256
+#define HDLC_MAX_REQUEST 5		// longest request payload (CMD_Baud with rate)
+#define HDLC_MAX_REPLY 17			// longest reply payload (CMD_pCAL, CMD_Collect)
+#define HDLC_MRU    (3+HDLC_MAX_REQUEST+2)	// longest received frame: addresses, ctrl, payload, CRC
+#define HDLC_SLOT_SIZE ((HDLC_MRU > 3+HDLC_MAX_REPLY) ? HDLC_MRU : 3+HDLC_MAX_REPLY)  // rx frame, reply built in place
+#define HDLC_RX_QUEUE 4		// received frames waiting for execution, power of 2
+#define HDLC_TX_MTU 64		// max. length of transmitted frame without CRC, sized for the wire buffer
+
+// Compile time check, fails with negative array size
+#define HDLC_STATIC_ASSERT(cond, name)	typedef char hdlc_assert_##name[(cond) ? 1 : -1]
 // HDLC constants --- RFC 1662 
 #define HDLC_FLAG_SOF				  0x7e   // Flag
 #define HDLC_CONTROL_ESCAPE 	0x7d   // Control Escape octet
 #define HDLC_ESCAPE_BIT     	0x20   // Transparency modifier octet (XOR bit)
-#define HDLC_CRC_INIT_VAL   	0xffff
-#define HDLC_CRC_MAGIC_VAL   	0xf0b8
-#define HDLC_CRC_POLYNOMIAL  	0x8408
 #define HDLC_UI_CMD						0x03     // Unnumbered Information with payload
 #define HDLC_FINAL_FLAG       0x10     // F flag
 #define HDLC_POLL_FLAG       0x10      // P flag
+#define HDLC_BROADCAST_ADDR		0xff     // frame for all nodes, never answered
 
 typedef enum
 {
 	HDLC_SOF_WAIT,
 	HDLC_DATARX,
 	HDLC_PROC_ESC,
+	HDLC_SKIP,				// frame for other node or dropped, CRC only up to next flag
+	HDLC_SKIP_ESC,		// ESCaped byte in skipped frame
 } hdlc_state_t;
 
 typedef struct 
@@ -39,16 +47,27 @@ typedef struct
 	uint8_t				src_addr;
 	uint8_t  			dest_addr;
 	uint8_t 			ctrl;
-	uint8_t				*p_tx_frame;			// tx frame buffer
+	uint8_t				*p_tx_frame;			// tx frame buffer, same as rx frame buffer
 	uint8_t 			*p_rx_frame;			// rx frame buffer
-	uint8_t				*p_payload;				// payload pointer
+	uint8_t				*p_payload;				// payload in rx frame, reply is written over it
+	uint16_t			payload_len;			// received payload length
 	uint16_t   		rx_frame_index;
-	uint16_t			rx_frame_fcs;
+	uint16_t			rx_frame_fcs;			// running CRC over received frame bytes
+	uint16_t			rx_frames;				// frames received for this node
+	uint16_t			rx_skipped;				// frames for other nodes dropped at address byte
+	uint16_t			rx_dropped;				// frames for this node dropped, queue full or too long
+	uint16_t			rx_crc_errors;		// frames for this node with bad CRC
+	volatile uint8_t	rx_head;		// queue slots written by decoder
+	volatile uint8_t	rx_tail;		// queue slots executed
+	uint8_t				rx_queue_max;			// max. number of queued frames seen
 	hdlc_state_t	state;
 } hdlc_t;
 
 void hdlc_init(void);
+void hdlc_rx_reset(void);
 void hdlc_process_rx_byte(uint8_t rx_byte);
+void hdlc_process_rx(const uint8_t *buf, uint16_t len);
+void hdlc_process(void);
 void hdlc_process_rx_frame(uint8_t *buf, uint16_t len);
 void hdlc_tx_frame(const uint8_t *txbuffer, uint8_t len);
 void hdlc_tx_raw_frame(const uint8_t *txbuffer, uint8_t len);
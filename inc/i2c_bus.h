@@ -0,0 +1,44 @@
+/**
+  ******************************************************************************
+  * File Name          : i2c_bus.h
+  * Description        : Interrupt driven I2C transfer queue
+  ******************************************************************************
+  *
+  * Copyright (c) 2016 S54MTB
+  * Licensed under Apache License 2.0 
+  * http://www.apache.org/licenses/LICENSE-2.0.html
+  *
+  ******************************************************************************
+  */
+#ifndef __I2C_BUS_H__
+#define __I2C_BUS_H__
+
+#include "stm32f0xx_hal.h"
+
+#define I2C_BUS_TIMEOUT		10			// ms, sensor transfers take well below 1 ms
+
+typedef struct i2c_xfer i2c_xfer_t;
+typedef void (*i2c_xfer_callback_t)(i2c_xfer_t *xfer);
+
+/* One transfer: optional write followed by optional read */
+struct i2c_xfer
+{
+	I2C_HandleTypeDef		*hi2c;
+	uint16_t						addr;				// 7-bit slave address
+	uint8_t							*tx;				// data to write, NULL when txlen is 0
+	uint16_t						txlen;
+	uint8_t							*rx;				// buffer for read, NULL when rxlen is 0
+	uint16_t						rxlen;
+	uint16_t						timeout;		// ms from start of the transfer
+	i2c_xfer_callback_t	callback;		// called from interrupt context when done, may be NULL
+	void								*ctx;				// user data for callback
+	volatile HAL_StatusTypeDef	status;	// HAL_BUSY until done
+	uint32_t						tstart;			// HAL tick when transfer was started
+	i2c_xfer_t					*next;			// queue link
+};
+
+HAL_StatusTypeDef i2c_bus_submit(i2c_xfer_t *xfer);
+void i2c_bus_process(void);
+HAL_StatusTypeDef i2c_bus_transfer(I2C_HandleTypeDef *hi2c, uint16_t addr, uint8_t *tx, uint16_t txlen, uint8_t *rx, uint16_t rxlen);
+
+#endif
@@ -0,0 +1,77 @@
+/**
+  ******************************************************************************
+  * File Name          : sampler.h
+  * Description        : Background sensor sampling
+  ******************************************************************************
+  *
+  * Copyright (c) 2016 S54MTB
+  * Licensed under Apache License 2.0 
+  * http://www.apache.org/licenses/LICENSE-2.0.html
+  *
+  ******************************************************************************
+  */
+#ifndef __SAMPLER_H__
+#define __SAMPLER_H__
+
+#include "stm32f0xx_hal.h"
+#include "MS5637.h"
+#include "hdc1080.h"
+
+/* Snapshot valid bits */
+#define SAMPLER_VALID_HDC1080		0x01		// temperature, humidity, bat
+#define SAMPLER_VALID_MS5637		0x02		// pressure, pTemperature, D1, D2
+
+#define SAMPLER_AGE_UNKNOWN			0xffff	// no sample yet or older than 65 s
+
+/* Latched sample state */
+#define SAMPLER_LATCH_NONE			0				// no trigger received
+#define SAMPLER_LATCH_PENDING		1				// triggered, sample set not complete yet
+#define SAMPLER_LATCH_READY			2				// sample set started after trigger is latched
+
+/* Background sampling resolution */
+#define SAMPLER_T_RES						HDC1080_T_RES_14
+#define SAMPLER_RH_RES					HDC1080_RH_RES_14
+#define SAMPLER_OSR							MS5637_OSR_8192
+
+/* Acquisition cycle events, see SAMPLER_TRACE_HOOK */
+typedef enum
+{
+	SAMPLER_TRACE_CYCLE_START,
+	SAMPLER_TRACE_HDC1080_START,
+	SAMPLER_TRACE_HDC1080_DONE,
+	SAMPLER_TRACE_MS5637_START,
+	SAMPLER_TRACE_MS5637_DONE,
+	SAMPLER_TRACE_CYCLE_DONE,
+} sampler_trace_event_t;
+
+/* Latest completed sample set */
+typedef struct
+{
+	uint32_t	timestamp;			// HAL tick when the sample set was completed
+	uint8_t		valid;					// SAMPLER_VALID_xxx
+	uint8_t		bat;						// hdc1080 battery status
+	int16_t		temperature;		// hdc1080, 0.01 degC
+	uint16_t	humidity;				// hdc1080, 0.01 RH%
+	int32_t		pTemperature;		// MS5637, 0.01 degC
+	int32_t		pressure;				// MS5637, 0.01 mbar
+	uint32_t	D1;							// MS5637 raw pressure
+	uint32_t	D2;							// MS5637 raw temperature
+} sampler_snapshot_t;
+
+void sampler_init(void);
+void sampler_process(void);
+const sampler_snapshot_t *sampler_snapshot(void);
+uint16_t sampler_age(void);
+const MS5637_cal_t *sampler_calibration(void);
+HAL_StatusTypeDef sampler_reload_calibration(void);
+void sampler_trigger(uint8_t tag);
+uint8_t sampler_collect(uint8_t *tag, const sampler_snapshot_t **s, uint16_t *age);
+HAL_StatusTypeDef sampler_measure_hdc1080(uint16_t budget_ms, uint8_t humidity, uint8_t *temp_res, uint8_t *humidres, int16_t *temperature, uint16_t *rh);
+HAL_StatusTypeDef sampler_measure_pressure(uint16_t budget_ms, uint8_t *osr, int32_t *temperature, int32_t *pressure);
+
+/* Build with SAMPLER_TRACE_HOOK to get the cycle timing, e.g. on the host */
+#ifdef SAMPLER_TRACE_HOOK
+void sampler_trace_hook(sampler_trace_event_t event);
+#endif
+
+#endif
@@ -13,9 +13,20 @@
 #ifndef __serial_h__
 #define __serial_h__
 
+#define UART_BAUD_AUTO	0			// CMD_Baud rate for auto baud rate detection
+#define UART_RX_RING	64		// circular DMA receive buffer, drained from interrupts at least every half
+
 
-void process_rx_char(char rx_char);
 void uart_puts(char *str);
+void uart_write(const uint8_t *buf, uint16_t len);
+void uart_tx_wait(void);
+void uart_rx_start(void);
+void uart_rx_irq(void);
+void uart_rx_mute(void);
+HAL_StatusTypeDef uart_baud_request(uint32_t baud);
+uint32_t uart_baudrate(void);
+void uart_baud_keepalive(void);
+void uart_baud_process(void);
 
 #endif
 
@@ -25,6 +25,8 @@ void NMI_Handler(void);
 void HardFault_Handler(void);
 void SysTick_Handler(void);
 void USART2_IRQHandler(void);
+void I2C1_IRQHandler(void);
+void DMA1_Channel4_5_IRQHandler(void);
 
 #ifdef __cplusplus
 }
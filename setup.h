@@ -5,15 +5,40 @@
 
 
 /** OWN HDLC Address */
-#define SETUP_OWNADDRESS	0x30
+#ifndef SETUP_OWNADDRESS
+#define SETUP_OWNADDRESS	0x30		// -DSETUP_OWNADDRESS=x for other nodes of one build
+#endif
 #define UNIQUE_ID					0x0d000011
-#define SETUP_BAUDRATE		9600
+#define SETUP_BAUDRATE		9600		// boot rate, fallback for CMD_Baud
+#define SETUP_BAUD_MAX		1000000	// highest rate accepted by CMD_Baud
+#define SETUP_BAUD_TIMEOUT	5000	// ms without valid frame before falling back to SETUP_BAUDRATE
+//#define SETUP_AUTOBAUD	1				// CMD_Baud with rate 0 measures the rate on 0x7F character
+#define SETUP_SAMPLE_PERIOD	1000		// background sensor sampling period in ms
+
+/** RS485 driver enable timing in 1/16 bit times (0..31), done by the USART.
+    Assert: DE high before the start bit, lets long lines settle after the
+    master released the bus. Deassert: DE held after the last stop bit. */
+#define SETUP_DE_ASSERT		0
+#define SETUP_DE_DEASSERT	0
+
+/** Hardware address filtering with USART mute mode.
+    Line runs 9-bit words, master sends address mark (0x100 | dest) 
+    before each frame. Receiver of other nodes stays muted until 
+    their own address, SETUP_OWNADDRESS must be below 0x80. 
+    Broadcast frames do not wake muted nodes. The receiver is muted 
+    again on the idle line after a frame, so the master must leave at 
+    least two idle characters between frames. Without the gap the next 
+    address mark reaches the HDLC decoder as data. */
+//#define SETUP_MUTEMODE	1
 
 
 // some debug messages
 //#define __DEBUG__ 1
 //#define __SKIPCRC__ 1
 
+// PA6 high while a received byte is decoded, decode time per byte on scope.
+#define SETUP_RX_PROBE 1
+
 #endif 
 
 
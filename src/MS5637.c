@@ -17,8 +17,8 @@
 
 #include "stm32f0xx_hal.h" 
 #include "MS5637.h"
+#include "i2c_bus.h"
 #include <string.h>
-#include <math.h>
 
 #define MS5637_ADDR 0x76
 #define MS5637_SKIP_CRC 1
@@ -34,7 +34,7 @@ HAL_StatusTypeDef MS5637_reset(I2C_HandleTypeDef *hi2c)
 	uint8_t cmd = MS5637_CMD_RESET;
 
 	/* Send the reset command */
-	return HAL_I2C_Master_Transmit(hi2c,MS5637_ADDR<<1,&cmd,1,100);	
+	return i2c_bus_transfer(hi2c, MS5637_ADDR, &cmd, 1, NULL, 0);	
 }
 
 /*
@@ -54,16 +54,8 @@ HAL_StatusTypeDef MS5637_read_PROM(I2C_HandleTypeDef *hi2c, uint8_t addr, uint16
 		return HAL_ERROR;
 	
 	buf[0] = MS5637_PROM_READ | (addr << 1);
-	/* Read register */
-	/* Send the read followed by address */
-	error = HAL_I2C_Master_Transmit(hi2c,MS5637_ADDR<<1,buf,1,100);
-	if (error != HAL_OK)
-		return error;
-
-	HAL_Delay(1); 
-	
-	/* Receive a 2-byte result */
-	error = HAL_I2C_Master_Receive(hi2c, MS5637_ADDR<<1 | 0x01, buf, 2, 1000);
+	/* Send the read followed by address, receive a 2-byte result */
+	error = i2c_bus_transfer(hi2c, MS5637_ADDR, buf, 1, buf, 2);
 	if (error != HAL_OK)
 		return error;
 	
@@ -76,19 +68,60 @@ HAL_StatusTypeDef MS5637_read_PROM(I2C_HandleTypeDef *hi2c, uint8_t addr, uint16
 
 
 /*
- * MS5637_read_ADC_TP() - Read ADC
- * @hi2c		:  handle to I2C interface
- * @channel	: MS5637_CONVERT_D1_BASE or MS5637_CONVERT_D2_BASE
- * @osr			: oversampling ratio for MS5637 ADC conversion
- * @val 		: ADC result (24 bit)
- * Returns HAL status or HAL_ERROR for invalid parameters.
+ * MS5637_read_calibration() - Read and check all PROM coefficients
+ * @hi2c:  handle to I2C interface
+ * @cal:   calibration cache to fill
+ *
+ * Reads C0..C7 and checks them against CRC4 from C0. The cache is marked 
+ * valid only when all reads succeeded and CRC matches, so it is enough to
+ * call this once after reset and reuse the coefficients for every reading.
+ * Returns HAL status or HAL_ERROR when CRC check fails.
  */
-HAL_StatusTypeDef MS5637_read_ADC_TP(I2C_HandleTypeDef *hi2c, uint8_t channel, uint8_t osr, uint32_t *val)
+HAL_StatusTypeDef MS5637_read_calibration(I2C_HandleTypeDef *hi2c, MS5637_cal_t *cal)
 {
-	uint8_t buf[3];
+	uint8_t i;
 	HAL_StatusTypeDef  error;
+	
+	cal->valid = 0;
+	for (i=0; i<8; i++)
+	{
+		error = MS5637_read_PROM(hi2c, i, &cal->C[i]); // c0 to c7
+		if (error != HAL_OK)
+			return error;
+	}
+	
+	if (MS5637_checkCRC4(cal->C) != ((cal->C[0] >> 12) & 0x000f))  // CRC check not passed
+		#ifdef MS5637_SKIP_CRC
+		return HAL_ERROR
+		#endif
+		;
+	
+	cal->valid = 1;
+	return HAL_OK;
+}
 
-	// Check argument
+
+/*
+ * MS5637_invalidate_calibration() - Force re-read of the PROM coefficients
+ * @cal:   calibration cache
+ */
+void MS5637_invalidate_calibration(MS5637_cal_t *cal)
+{
+	cal->valid = 0;
+}
+
+
+/* Maximum ADC conversion time in us for OSR 256 ... 8192, datasheet page 3 */
+static const uint16_t MS5637_conv_time_us[6] = { 540, 1060, 2080, 4130, 8220, 16440 };
+
+
+/*
+ * MS5637_check_osr() - Check oversampling ratio argument
+ * @osr			: oversampling ratio for MS5637 ADC conversion
+ * Returns HAL_OK for valid OSR or HAL_ERROR.
+ */
+static HAL_StatusTypeDef MS5637_check_osr(uint8_t osr)
+{
 	if ((osr != MS5637_OSR_256) &
 		  (osr != MS5637_OSR_512) &
 		  (osr != MS5637_OSR_1024) &
@@ -96,41 +129,252 @@ HAL_StatusTypeDef MS5637_read_ADC_TP(I2C_HandleTypeDef *hi2c, uint8_t channel, u
 		  (osr != MS5637_OSR_4096) &
 	    (osr != MS5637_OSR_8192) )
 		return HAL_ERROR;
+	return HAL_OK;
+}
+
+
+/*
+ * MS5637_conversion_time_us() - ADC conversion time for selected OSR
+ * @osr			: oversampling ratio for MS5637 ADC conversion
+ * Returns maximum conversion time in us, 0 for invalid OSR.
+ */
+uint16_t MS5637_conversion_time_us(uint8_t osr)
+{
+	if (MS5637_check_osr(osr) != HAL_OK)
+		return 0;
+	return MS5637_conv_time_us[osr >> 1];
+}
+
+
+/*
+ * MS5637_conversion_time() - Minimum wait for ADC conversion
+ * @osr			: oversampling ratio for MS5637 ADC conversion
+ *
+ * Conversion time rounded up to whole ms. A conversion started at tick 
+ * tstart is complete once (HAL_GetTick() - tstart) > returned value.
+ * Returns wait in ms (HAL ticks), 0 for invalid OSR.
+ */
+uint8_t MS5637_conversion_time(uint8_t osr)
+{
+	return (MS5637_conversion_time_us(osr) + 999) / 1000;
+}
+
+
+/*
+ * MS5637_start_ADC() - Start ADC conversion
+ * @hi2c		:  handle to I2C interface
+ * @channel	: MS5637_CONVERT_D1_BASE or MS5637_CONVERT_D2_BASE
+ * @osr			: oversampling ratio for MS5637 ADC conversion
+ * Returns HAL status or HAL_ERROR for invalid parameters.
+ */
+HAL_StatusTypeDef MS5637_start_ADC(I2C_HandleTypeDef *hi2c, uint8_t channel, uint8_t osr)
+{
+	uint8_t cmd;
+
+	// Check argument
+	if (MS5637_check_osr(osr) != HAL_OK)
+		return HAL_ERROR;
 	
 	if ((channel != MS5637_CONVERT_D1_BASE) &
 	    (channel != MS5637_CONVERT_D2_BASE) )
 		return HAL_ERROR;
 	
-	buf[0] = channel | osr;
-	/* Send the read followed by cmd */
-	error = HAL_I2C_Master_Transmit(hi2c,MS5637_ADDR<<1,buf,1,100);
+	cmd = channel | osr;
+	/* Send the conversion command */
+	return i2c_bus_transfer(hi2c, MS5637_ADDR, &cmd, 1, NULL, 0);
+}
+
+
+/*
+ * MS5637_read_ADC() - Read result of the finished ADC conversion
+ * @hi2c		:  handle to I2C interface
+ * @val 		: ADC result (24 bit)
+ * Returns HAL status.
+ */
+HAL_StatusTypeDef MS5637_read_ADC(I2C_HandleTypeDef *hi2c, uint32_t *val)
+{
+	uint8_t buf[3];
+	HAL_StatusTypeDef  error;
+
+	buf[0] = MS5637_ADC_READ;
+	/* Send the read followed by cmd, receive a 3-byte result */
+	error = i2c_bus_transfer(hi2c, MS5637_ADDR, buf, 1, buf, 3);
 	if (error != HAL_OK)
 		return error;
-
-	HAL_Delay(10*osr); 
 	
-	buf[0] = MS5637_ADC_READ;
-	/* Send the read followed by cmd */
-	error = HAL_I2C_Master_Transmit(hi2c,MS5637_ADDR<<1,buf,1,100);
+	/* Result */
+	*val = buf[0]*256*256+buf[1]*256+buf[2]; 
+
+	return HAL_OK;  /* Success */
+}
+
+
+/*
+ * MS5637_read_ADC_TP() - Read ADC
+ * @hi2c		:  handle to I2C interface
+ * @channel	: MS5637_CONVERT_D1_BASE or MS5637_CONVERT_D2_BASE
+ * @osr			: oversampling ratio for MS5637 ADC conversion
+ * @val 		: ADC result (24 bit)
+ *
+ * Blocking version, waits for the conversion time of selected OSR.
+ * Returns HAL status or HAL_ERROR for invalid parameters.
+ */
+HAL_StatusTypeDef MS5637_read_ADC_TP(I2C_HandleTypeDef *hi2c, uint8_t channel, uint8_t osr, uint32_t *val)
+{
+	HAL_StatusTypeDef  error;
+	uint32_t tstart;
+
+	error = MS5637_start_ADC(hi2c, channel, osr);
 	if (error != HAL_OK)
 		return error;
 	
-	HAL_Delay(osr); 
+	tstart = HAL_GetTick();
+	while ((HAL_GetTick() - tstart) <= MS5637_conversion_time(osr))
+	{
+	}
 	
-	/* Receive a 3-byte result */
-	error = HAL_I2C_Master_Receive(hi2c, MS5637_ADDR<<1 | 0x01, buf, 3, 1000);
+	return MS5637_read_ADC(hi2c, val);
+}
+
+
+/*
+ * MS5637_conv_start() - Start non-blocking D1 and D2 conversion sequence
+ * @hi2c		:  handle to I2C interface
+ * @conv		: conversion state 
+ * @osr			: oversampling ratio for both conversions
+ * Returns HAL status, conversion state is MS5637_CONV_ERROR on failure.
+ */
+HAL_StatusTypeDef MS5637_conv_start(I2C_HandleTypeDef *hi2c, MS5637_conv_t *conv, uint8_t osr)
+{
+	HAL_StatusTypeDef  error;
+	
+	conv->osr = osr;
+	error = MS5637_start_ADC(hi2c, MS5637_CONVERT_D1_BASE, osr);
 	if (error != HAL_OK)
+	{
+		conv->state = MS5637_CONV_ERROR;
 		return error;
-	
-	/* Result */
-	*val = buf[0]*256*256+buf[1]*256+buf[2]; 
+	}
+	conv->tstart = HAL_GetTick();
+	conv->state = MS5637_CONV_D1;
+	return HAL_OK;
+}
 
-	return HAL_OK;  /* Success */
+
+/*
+ * MS5637_conv_poll() - Advance conversion sequence started by MS5637_conv_start()
+ * @hi2c		:  handle to I2C interface
+ * @conv		: conversion state 
+ *
+ * Call periodically. When the running conversion time has expired, its
+ * result is read and the next conversion is started. Never waits.
+ * Returns HAL_BUSY while converting, HAL_OK when D1 and D2 are available 
+ * in conv, or error status.
+ */
+HAL_StatusTypeDef MS5637_conv_poll(I2C_HandleTypeDef *hi2c, MS5637_conv_t *conv)
+{
+	HAL_StatusTypeDef  error = HAL_OK;
+	
+	switch (conv->state)
+	{
+		case MS5637_CONV_D1:
+			if ((HAL_GetTick() - conv->tstart) <= MS5637_conversion_time(conv->osr))
+				return HAL_BUSY;
+			error = MS5637_read_ADC(hi2c, &conv->D1);
+			if (error == HAL_OK)
+				error = MS5637_start_ADC(hi2c, MS5637_CONVERT_D2_BASE, conv->osr);
+			if (error != HAL_OK)
+				break;
+			conv->tstart = HAL_GetTick();
+			conv->state = MS5637_CONV_D2;
+			return HAL_BUSY;
+		
+		case MS5637_CONV_D2:
+			if ((HAL_GetTick() - conv->tstart) <= MS5637_conversion_time(conv->osr))
+				return HAL_BUSY;
+			error = MS5637_read_ADC(hi2c, &conv->D2);
+			if (error != HAL_OK)
+				break;
+			conv->state = MS5637_CONV_DONE;
+			return HAL_OK;
+		
+		case MS5637_CONV_DONE:
+			return HAL_OK;
+		
+		default:
+			return HAL_ERROR;
+	}
 	
+	conv->state = MS5637_CONV_ERROR;
+	return error;
 }
 
 
 
+/*
+ * MS5637_Calculate_int() - Integer compensation of pressure and temperature
+ * @C				: Calibration coefficients, equal memory map as in MS5637
+ * @D1			: ADC Readout from MS5637_CONVERT_D1_BASE 
+ * @D2			: ADC Readout from MS5637_CONVERT_D2_BASE
+ * @Temperature 		: Compensated temperature in 0.01C
+ * @Pressure    		: Compensated pressure in 0.01 mbar (Pa)
+ *
+ * First and second order compensation with int32/int64 arithmetic only, 
+ * as given in the datasheet. No floating point, so it is cheap on Cortex-M0.
+ * Results differ from the former floating point code by up to 1 LSB in
+ * temperature and 11 Pa in pressure, at the cold end (host test_ms5637_calc).
+ * PROM CRC is not checked here.
+ * Returns HAL_ERROR when the result is out of the sensor operating range.
+ */
+HAL_StatusTypeDef MS5637_Calculate_int(const uint16_t *C, uint32_t D1, uint32_t D2, int32_t *Temperature, int32_t *Pressure)
+{
+	int32_t dT, TEMP, dTEMP;
+	int64_t OFF, SENS, T2, OFF2, SENS2;
+	
+	dT   = (int32_t)D2 - ((int32_t)C[5] << 8);    // Calculate dT, OFF and SENS, datasheet page 6
+	TEMP = 2000 + (int32_t)(((int64_t)dT * C[6]) >> 23);
+	OFF  = ((int64_t)C[2] << 17) + (((int64_t)C[4] * dT) >> 6);
+	SENS = ((int64_t)C[1] << 16) + (((int64_t)C[3] * dT) >> 7);
+	
+//-------------------------------------------
+// Calculate second order corrections
+	if (TEMP >= 2000)   // correction above 20C
+	{
+		T2    = (5 * (int64_t)dT * dT) >> 38;
+		OFF2  = 0;
+		SENS2 = 0;
+	}
+	else                // correction below 20C
+	{
+		dTEMP = TEMP - 2000;
+		T2    = (3 * (int64_t)dT * dT) >> 33;
+		OFF2  = (61 * (int64_t)dTEMP * dTEMP) >> 4;
+		SENS2 = (29 * (int64_t)dTEMP * dTEMP) >> 4;
+		if (TEMP < -1500) // correction below -15C
+		{
+			dTEMP = TEMP + 1500;
+			OFF2  += 17 * (int64_t)dTEMP * dTEMP;
+			SENS2 +=  9 * (int64_t)dTEMP * dTEMP;
+		}
+	}
+ // End of second order corrections
+ //-------------------------------------------
+	TEMP -= (int32_t)T2;
+	OFF  -= OFF2;
+	SENS -= SENS2;
+	
+	*Temperature = TEMP;
+	*Pressure = (int32_t)(((((int64_t)D1 * SENS) >> 21) - OFF) >> 15);
+
+	if ( (TEMP < -4000) | (TEMP > 8500) |
+		   (*Pressure < 1000) | (*Pressure > 200000))
+	return 
+		HAL_ERROR;
+	else	
+	  return HAL_OK;
+}
+
+
 /*
  * MS5637_Calculate() - Calculate pressure and temperature form calibration coefficients 
  * @C				: Calibration coefficients, equal memory map as in MS5637
@@ -138,12 +382,15 @@ HAL_StatusTypeDef MS5637_read_ADC_TP(I2C_HandleTypeDef *hi2c, uint8_t channel, u
  * @D2			: ADC Readout from MS5637_CONVERT_D2_BASE
  * @Temperature 		: Calculated MS5637 sensor temperature in C
  * @Pressure    		: Calculated MS5637 sensor pressure in mBar
+ *
+ * Floating point wrapper around MS5637_Calculate_int().
  * Returns HAL status or HAL_ERROR for invalid parameters.
  */
 HAL_StatusTypeDef MS5637_Calculate(uint16_t *C, uint32_t D1, uint32_t D2, double *Temperature, double *Pressure)
 {
 	unsigned char nCRC4;       // check sum to ensure PROM integrity
-	double dT, OFFSET, SENS, T2, OFFSET2, SENS2;  // Raw data for calculation
+	int32_t T, P;
+	HAL_StatusTypeDef error;
 	
 	unsigned char refCRC4 = (C[0] >> 12) & 0x000f;
 
@@ -154,46 +401,12 @@ HAL_StatusTypeDef MS5637_Calculate(uint16_t *C, uint32_t D1, uint32_t D2, double
 		#endif
 		;
 	
-	dT = D2 - C[5]*pow(2,8);    // Calculate dT, OFS and SENS, datasheet page 6
-  OFFSET = C[2]*pow(2, 17) + dT*C[4]/pow(2,6);
-  SENS = C[1]*pow(2,16) + dT*C[3]/pow(2,7);
- 
-  *Temperature = (2000 + ((dT*C[6]))/pow(2, 23))/100;  // MS5637 temp has 0.01C "unit" - convert to 1C 
-//-------------------------------------------
-// Calculate second order corrections
-	if(*Temperature > 20.0f) 
-	{
-		T2 = 5*dT*dT/pow(2, 38); // correction above 20C
-		OFFSET2 = 0;
-		SENS2 = 0;
-	}
-	if(*Temperature < 20.0f)   // correction below 20C
-	{
-		T2      = 3*dT*dT/pow(2, 33); 
-		OFFSET2 = 61*(100 * *Temperature - 2000)*(100 * *Temperature - 2000)/16;
-		SENS2   = 29*(100 * *Temperature - 2000)*(100 * *Temperature - 2000)/16;
-	} 
-	if(*Temperature < -15.0f)     // correction below -15C
-	{
-		OFFSET2 = OFFSET2 + 17*(100 * *Temperature + 1500)*(100 * *Temperature + 1500);
-		SENS2 = SENS2 + 9*(100 * *Temperature + 1500)*(100 * *Temperature + 1500);
-  }
- // End of second order corrections
- //-------------------------------------------
-	*Temperature = *Temperature - T2/100;
-	OFFSET = OFFSET - OFFSET2;
-	SENS = SENS - SENS2;
+	error = MS5637_Calculate_int(C, D1, D2, &T, &P);
 	
-	// Pressure in mbar or hPa
-	*Pressure = (((D1*SENS)/pow(2, 21) - OFFSET)/pow(2, 15))/100; 
-
-	if ( (*Temperature < -40.0f) | (*Temperature > 85.0f) |
-		   (*Pressure < 10.0f) | (*Pressure > 2000.0f))
-	return 
-		HAL_ERROR;
-	else	
-	  return HAL_OK;
+	*Temperature = T / 100.0;   // 0.01C "unit" - convert to 1C
+	*Pressure = P / 100.0;      // 0.01 mbar "unit" - convert to mbar or hPa
 	
+	return error;
 }
 
 
@@ -204,18 +417,20 @@ HAL_StatusTypeDef MS5637_Calculate(uint16_t *C, uint32_t D1, uint32_t D2, double
  * @C				: Calibration coefficients, equal memory map as in MS5637
  * Returns CRC-4 calculation from C[]
  */
-unsigned char MS5637_checkCRC4(uint16_t * C)
+unsigned char MS5637_checkCRC4(const uint16_t * C)
 {
   int cnt;
   unsigned int n_rem = 0;
   unsigned char n_bit;
+  uint16_t n_prom[8];
   
-  C[0] = ((C[0]) & 0x0FFF);  // replace CRC byte by 0 for checksum calculation
-  C[7] = 0;
+  memcpy(n_prom, C, sizeof(n_prom));  // work on a copy, keep the caller's coefficients intact
+  n_prom[0] = ((n_prom[0]) & 0x0FFF);  // replace CRC byte by 0 for checksum calculation
+  n_prom[7] = 0;
   for(cnt = 0; cnt < 16; cnt++)
   {
-    if(cnt%2==1) n_rem ^= (unsigned short) ((C[cnt>>1]) & 0x00FF);
-    else         n_rem ^= (unsigned short)  (C[cnt>>1]>>8);
+    if(cnt%2==1) n_rem ^= (unsigned short) ((n_prom[cnt>>1]) & 0x00FF);
+    else         n_rem ^= (unsigned short)  (n_prom[cnt>>1]>>8);
     for(n_bit = 8; n_bit > 0; n_bit--)
     {
         if(n_rem & 0x8000)    n_rem = (n_rem<<1) ^ 0x3000;
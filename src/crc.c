@@ -1,9 +1,21 @@
 
 #include "stm32f0xx.h"          // Device header, mostly for uintX_t defines
+#include "crc.h"
 
 
 
 /**** Software CRC16 --- F0 hardware works with 32-bit only **/
+#if CRC16_KERNEL == CRC16_KERNEL_NIBBLE
+
+// CRC16 look-up table for one nibble, first 16 entries of byte table
+static const uint16_t crc16_table[16] =
+{
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7, 0x8108,
+    0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef,
+};
+
+#else
+
 // CRC16 look-up table
 const uint16_t crc16_table[256] =
 {
@@ -38,19 +50,138 @@ const uint16_t crc16_table[256] =
     0x2e93, 0x3eb2, 0x0ed1, 0x1ef0,
 };
 
+#endif
+
+#if CRC16_KERNEL >= CRC16_KERNEL_SLICE4
+
+// crc16_slice[k][b]: CRC of byte b followed by k+1 zero bytes
+static uint16_t crc16_slice[CRC16_KERNEL-1][256];
+static uint8_t crc16_slice_ready;
+
+static void crc16_slice_init(void)
+{
+    uint16_t b, crc;
+    uint8_t k;
+
+    for (b = 0; b < 256; b++)
+    {
+        crc = crc16_table[b];
+        for (k = 0; k < CRC16_KERNEL-1; k++)
+        {
+            crc = crc16_table[crc >> 8] ^ (crc << 8);
+            crc16_slice[k][b] = crc;
+        }
+    }
+    crc16_slice_ready = 1;
+}
+
+#endif
+
 /**
- *  Calculate CRC16 checksum.
+ *  Add one byte to running CRC16, start with CRC16_INIT_VAL.
  *
  */
-uint16_t crc16(uint8_t *startaddr, uint8_t len)
+uint16_t crc16_update(uint16_t crc, uint8_t byte)
 {
-    uint16_t crc = 0x0000;
+#if CRC16_KERNEL == CRC16_KERNEL_NIBBLE
+    crc = crc16_table[(crc >> 12) ^ (byte >> 4)] ^ (crc << 4);
+    return crc16_table[(crc >> 12) ^ (byte & 0x0f)] ^ (crc << 4);
+#else
+    return crc16_table[(crc >> 8) ^ byte] ^ (crc << 8);
+#endif
+}
+
+#if CRC16_BACKEND == CRC16_BACKEND_HW
+
+#if !defined(STM32F071xB) && !defined(STM32F072xB) && !defined(STM32F078xx) && \
+    !defined(STM32F091xC) && !defined(STM32F098xx)
+#error "CRC16_BACKEND_HW needs a CRC unit with programmable polynomial"
+#endif
+
+static CRC_HandleTypeDef hcrc16;
+static uint8_t crc16_hw_ready;
+
+/**
+ *  Continue CRC16 in CRC unit, configured for XMODEM on first use.
+ *
+ */
+static uint16_t crc16_hw(uint16_t crc, const uint8_t *startaddr, uint16_t len)
+{
+    if (!crc16_hw_ready)
+    {
+        hcrc16.Instance = CRC;
+        hcrc16.Init.DefaultPolynomialUse = DEFAULT_POLYNOMIAL_DISABLE;
+        hcrc16.Init.GeneratingPolynomial = 0x1021;
+        hcrc16.Init.CRCLength = CRC_POLYLENGTH_16B;
+        hcrc16.Init.DefaultInitValueUse = DEFAULT_INIT_VALUE_DISABLE;
+        hcrc16.Init.InitValue = CRC16_INIT_VAL;
+        hcrc16.Init.InputDataInversionMode = CRC_INPUTDATA_INVERSION_NONE;
+        hcrc16.Init.OutputDataInversionMode = CRC_OUTPUTDATA_INVERSION_DISABLE;
+        hcrc16.InputDataFormat = CRC_INPUTDATA_FORMAT_BYTES;
+        HAL_CRC_Init(&hcrc16);
+        crc16_hw_ready = 1;
+    }
+
+    WRITE_REG(hcrc16.Instance->INIT, crc);     // continue from given CRC
+    __HAL_CRC_DR_RESET(&hcrc16);
+    return (uint16_t)HAL_CRC_Accumulate(&hcrc16, (uint32_t *)startaddr, len);
+}
+
+#else
+
+/**
+ *  Continue CRC16 over block in software kernel.
+ *
+ */
+static uint16_t crc16_sw(uint16_t crc, const uint8_t *startaddr, uint16_t len)
+{
+#if CRC16_KERNEL >= CRC16_KERNEL_SLICE4
+    if (!crc16_slice_ready)
+        crc16_slice_init();
+
+    while (len >= CRC16_KERNEL)
+    {
+        crc = crc16_slice[CRC16_KERNEL-2][(crc >> 8) ^ startaddr[0]] ^
+              crc16_slice[CRC16_KERNEL-3][(crc & 0xff) ^ startaddr[1]] ^
+#if CRC16_KERNEL == CRC16_KERNEL_SLICE8
+              crc16_slice[4][startaddr[2]] ^ crc16_slice[3][startaddr[3]] ^
+              crc16_slice[2][startaddr[4]] ^ crc16_slice[1][startaddr[5]] ^
+#endif
+              crc16_slice[0][startaddr[CRC16_KERNEL-2]] ^ crc16_table[startaddr[CRC16_KERNEL-1]];
+        startaddr += CRC16_KERNEL;
+        len -= CRC16_KERNEL;
+    }
+#endif
 
     while (len > 0)
     {
-        crc = crc16_table[(crc >> 8) ^ *startaddr] ^ (crc << 8);
+        crc = crc16_update(crc, *startaddr);
         startaddr++; // next address
         len--;
     }
     return crc;
 }
+
+#endif
+
+/**
+ *  Continue running CRC16 over block, start with CRC16_INIT_VAL.
+ *
+ */
+uint16_t crc16_accumulate(uint16_t crc, const uint8_t *data_p, uint16_t length)
+{
+#if CRC16_BACKEND == CRC16_BACKEND_HW
+    return crc16_hw(crc, data_p, length);
+#else
+    return crc16_sw(crc, data_p, length);
+#endif
+}
+
+/**
+ *  Calculate CRC16 checksum.
+ *
+ */
+uint16_t crc16(const uint8_t *data_p, uint16_t length)
+{
+    return crc16_accumulate(CRC16_INIT_VAL, data_p, length);
+}
@@ -17,6 +17,7 @@
 
 #include "stm32f0xx_hal.h" 
 #include "hdc1080.h"
+#include "i2c_bus.h"
 #include <string.h>
 
 #define HDC1080_ADDR 0x40 
@@ -25,7 +26,7 @@
 /*
  * hdc1080_read_reg() - Read User register
  * @hi2c:  handle to I2C interface
- * @delay: Delay before read
+ * @delay: Delay before read in ms, 0 for registers without conversion
  * @reg: Register address
  * @val: 16-bit register value from the hdc1080
  * Returns HAL status or HAL_ERROR for invalid parameters.
@@ -48,15 +49,23 @@ HAL_StatusTypeDef hdc1080_read_reg(I2C_HandleTypeDef *hi2c, uint16_t delay, uint
 	
 	buf[0] = reg;
 	/* Read register */
-	/* Send the read followed by address */
-	error = HAL_I2C_Master_Transmit(hi2c,HDC1080_ADDR<<1,buf,1,100);
-	if (error != HAL_OK)
-		return error;
+	if (delay == 0)
+	{
+		/* Send the address and receive a 2-byte result in one go */
+		error = i2c_bus_transfer(hi2c, HDC1080_ADDR, buf, 1, buf, 2);
+	}
+	else
+	{
+		/* Send the read followed by address */
+		error = i2c_bus_transfer(hi2c, HDC1080_ADDR, buf, 1, NULL, 0);
+		if (error != HAL_OK)
+			return error;
 
-	HAL_Delay(delay); 
+		HAL_Delay(delay); 
 	
-	/* Receive a 2-byte result */
-	error = HAL_I2C_Master_Receive(hi2c, HDC1080_ADDR<<1 | 0x01, buf, 2, 1000);
+		/* Receive a 2-byte result */
+		error = i2c_bus_transfer(hi2c, HDC1080_ADDR, NULL, 0, buf, 2);
+	}
 	if (error != HAL_OK)
 		return error;
 	
@@ -90,7 +99,7 @@ HAL_StatusTypeDef hdc1080_write_reg(I2C_HandleTypeDef *hi2c, uint8_t reg, uint16
 	buf[2] = (uint8_t)(val & 0xff); 				// lsb
 	/* Write the register */
 	/* Send the command and data */
-	error = HAL_I2C_Master_Transmit(hi2c,HDC1080_ADDR<<1,buf,3,100);
+	error = i2c_bus_transfer(hi2c, HDC1080_ADDR, buf, 3, NULL, 0);
 	if (error != HAL_OK)
 		return error;
   else 
@@ -100,6 +109,179 @@ HAL_StatusTypeDef hdc1080_write_reg(I2C_HandleTypeDef *hi2c, uint8_t reg, uint16
 
 
 
+/* Typical conversion time in us, datasheet page 5 gives no maximum */
+static const uint16_t hdc1080_t_conv_us[2]  = { 6350, 3650 };         // HDC1080_T_RES_14, _11
+static const uint16_t hdc1080_rh_conv_us[3] = { 6500, 3850, 2500 };   // HDC1080_RH_RES_14, _11, 8
+
+/* Last configuration written to the sensor */
+static uint16_t hdc1080_config;
+static uint8_t  hdc1080_config_valid = 0;
+
+
+/*
+ * hdc1080_conversion_time_us() - Time for combined temperature and humidity conversion
+ * @temp_res    :  HDC1080_T_RES_14 or HDC1080_T_RES_11
+ * @humidres    :  HDC1080_RH_RES_14, HDC1080_RH_RES_11 or HDC1080_RH_RES8
+ * Returns conversion time in us, 0 for invalid resolution.
+ */
+uint16_t hdc1080_conversion_time_us(uint8_t temp_res, uint8_t humidres)
+{
+	if ((temp_res > HDC1080_T_RES_11) | (humidres > HDC1080_RH_RES8))
+		return 0;
+	return hdc1080_t_conv_us[temp_res] + hdc1080_rh_conv_us[humidres];
+}
+
+
+/*
+ * hdc1080_conversion_time() - Minimum wait for combined conversion
+ * @temp_res    :  HDC1080_T_RES_14 or HDC1080_T_RES_11
+ * @humidres    :  HDC1080_RH_RES_14, HDC1080_RH_RES_11 or HDC1080_RH_RES8
+ *
+ * Conversion time rounded up to whole ms. A conversion triggered at tick 
+ * tstart is complete once (HAL_GetTick() - tstart) > returned value.
+ * Returns wait in ms (HAL ticks), 0 for invalid resolution.
+ */
+uint8_t hdc1080_conversion_time(uint8_t temp_res, uint8_t humidres)
+{
+	return (hdc1080_conversion_time_us(temp_res, humidres) + 999) / 1000;
+}
+
+
+/*
+ * hdc1080_temperature() - Convert raw temperature to 0.01C
+ */
+int16_t hdc1080_temperature(uint16_t raw)
+{
+	return (int16_t)((((uint32_t)raw * 16500) >> 16) - 4000);
+}
+
+
+/*
+ * hdc1080_humidity() - Convert raw humidity to 0.01 RH%
+ */
+uint16_t hdc1080_humidity(uint16_t raw)
+{
+	uint32_t rh = ((uint32_t)raw * 10000) >> 16;
+	
+	if (rh > 10000) rh = 10000;
+	return (uint16_t)rh;
+}
+
+
+/*
+ * hdc1080_conv_start() - Trigger temperature and humidity acquisition
+ * @hi2c:  handle to I2C interface
+ * @conv        :  conversion state
+ * @temp_res    :  temperature measurement resolution
+ * @humidres    :  humidity readout resolution
+ * @heater      :  heater enable (0 = disabled or 1 = enabled)
+ *
+ * Acquisition mode (config Bit[12]) is used, so one trigger converts both 
+ * values. Config register is written only when it differs from the last 
+ * value written.
+ * Returns HAL status, conversion state is HDC1080_CONV_ERROR on failure.
+ */
+HAL_StatusTypeDef hdc1080_conv_start(I2C_HandleTypeDef *hi2c, hdc1080_conv_t *conv,
+  uint8_t temp_res, uint8_t humidres, uint8_t heater)
+{
+	HAL_StatusTypeDef error;
+	uint16_t r;
+	uint8_t cmd = HDC1080_TEMPERATURE;
+	
+	conv->state = HDC1080_CONV_ERROR;
+	conv->tconv = hdc1080_conversion_time(temp_res, humidres);
+	if (conv->tconv == 0)
+		return HAL_ERROR;
+	
+	r  = temp_res<<10;
+	r |= humidres<<8;
+	r |= 1<<12;     // mode = 1;
+	r |= heater<<13;
+	
+	if ((!hdc1080_config_valid) | (hdc1080_config != r))
+	{
+		// write config
+		hdc1080_config_valid = 0;
+		error = hdc1080_write_reg(hi2c, HDC1080_CONFIG, r);
+		if (error != HAL_OK) return error;
+		hdc1080_config = r;
+		hdc1080_config_valid = 1;
+	}
+	
+	// trigger by writing temperature register address
+	error = i2c_bus_transfer(hi2c, HDC1080_ADDR, &cmd, 1, NULL, 0);
+	if (error != HAL_OK)
+	{
+		hdc1080_config_valid = 0;   // sensor may have been reset, rewrite config next time
+		return error;
+	}
+	
+	conv->tstart = HAL_GetTick();
+	conv->tretry = conv->tstart;
+	conv->state = HDC1080_CONV_BUSY;
+	return HAL_OK;
+}
+
+
+/*
+ * hdc1080_conv_poll() - Read results when conversion time has expired
+ * @hi2c:  handle to I2C interface
+ * @conv        :  conversion state
+ *
+ * Temperature and humidity are read in one 4-byte transfer, followed by 
+ * a config register read for the battery status. Never waits.
+ * Conversion times are typical values, the sensor NACKs the read until 
+ * results are ready. Such a read is retried once per HAL tick for up to 
+ * HDC1080_READY_TIMEOUT ms, calls within the same tick return HAL_BUSY 
+ * without touching the bus.
+ * Returns HAL_BUSY while converting, HAL_OK when results are in conv, 
+ * or error status.
+ */
+HAL_StatusTypeDef hdc1080_conv_poll(I2C_HandleTypeDef *hi2c, hdc1080_conv_t *conv)
+{
+	HAL_StatusTypeDef error;
+	uint8_t buf[4];
+	uint16_t r;
+	uint32_t tick;
+	
+	switch (conv->state)
+	{
+		case HDC1080_CONV_BUSY:
+			tick = HAL_GetTick();
+			if (((tick - conv->tstart) <= conv->tconv) | (tick == conv->tretry))
+				return HAL_BUSY;
+		
+			/* Receive temperature and humidity */
+			error = i2c_bus_transfer(hi2c, HDC1080_ADDR, NULL, 0, buf, 4);
+			if ((error == HAL_ERROR) && ((hi2c->ErrorCode & HAL_I2C_ERROR_AF) != 0U) &&
+			    ((tick - conv->tstart) <= conv->tconv + (uint32_t)HDC1080_READY_TIMEOUT))
+			{
+				conv->tretry = tick;    // not ready yet, next read on a later tick
+				return HAL_BUSY;
+			}
+			if (error == HAL_OK)
+				error = hdc1080_read_reg(hi2c, 0, HDC1080_CONFIG, &r);
+			if (error != HAL_OK)
+			{
+				hdc1080_config_valid = 0;
+				conv->state = HDC1080_CONV_ERROR;
+				return error;
+			}
+			conv->temperature = buf[0]*256+buf[1];
+			conv->humidity = buf[2]*256+buf[3];
+			conv->bat_stat = (r>>11) & 0x0001;
+			conv->state = HDC1080_CONV_DONE;
+			return HAL_OK;
+		
+		case HDC1080_CONV_DONE:
+			return HAL_OK;
+		
+		default:
+			return HAL_ERROR;
+	}
+}
+
+
 /*
  * hdc1080_measure() - measure humididty and temperature: 
 
@@ -137,6 +319,8 @@ return a NACK if the contents of the registers have not been updated.
  *										- 1 when Ucc < 2,8V
  * @temperature :  floating point temperature result, unit is C
  * @humidity    :  floating point humidity result, unit is RH%
+ *
+ * Blocking version of hdc1080_conv_start() / hdc1080_conv_poll().
  * Returns HAL status.
  */
 HAL_StatusTypeDef hdc1080_measure(I2C_HandleTypeDef *hi2c,
@@ -144,40 +328,20 @@ HAL_StatusTypeDef hdc1080_measure(I2C_HandleTypeDef *hi2c,
 	uint8_t *bat_stat, double *temperature,	double *humidity)
 {
 	HAL_StatusTypeDef error;
-	uint16_t r;
-	double tmp;
+	hdc1080_conv_t conv;
 	
-	
-	error = hdc1080_read_reg(hi2c, 10, HDC1080_CONFIG, &r);
+	error = hdc1080_conv_start(hi2c, &conv, temp_res, humidres, heater);
 	if (error != HAL_OK) return error;
-
-	r |= temp_res<<10;
-	r |= humidres<<8;
-	r |= 1<<12;     // mode = 1;
-	r |= heater<<13;
 	
-	*bat_stat = (r>>11) & 0x0001;
-	
-	// write config
-	error = hdc1080_write_reg(hi2c, HDC1080_CONFIG, r);
+	do 
+	{
+		error = hdc1080_conv_poll(hi2c, &conv);
+	} while (error == HAL_BUSY);
 	if (error != HAL_OK) return error;
 	
-
-	error = hdc1080_read_reg(hi2c, 150, HDC1080_TEMPERATURE, &r);
-	if (error != HAL_OK) return error;
-	tmp = (double)r;
-	tmp = (tmp / 65536.0f) * 165.0f - 40.0f;
-	*temperature = tmp;  // C
-	
-	error = hdc1080_read_reg(hi2c, 150, HDC1080_HUMIDITY, &r);
-	tmp = (int32_t)r;
-	
-	if (error != HAL_OK) return error;
-	tmp = (float)r;
-	tmp = (tmp / 65536.0f) * 100.0f;
-	if (tmp>100.0) tmp = 100.0f;
-	if (tmp<0) tmp = 0.0f;
-	*humidity = tmp;
+	*bat_stat = conv.bat_stat;
+	*temperature = hdc1080_temperature(conv.temperature) / 100.0;  // C
+	*humidity = hdc1080_humidity(conv.humidity) / 100.0;
 	
 	return HAL_OK;
 }
@@ -197,22 +361,22 @@ HAL_StatusTypeDef hdc1080_get_device_id(I2C_HandleTypeDef *hi2c, uint64_t *seria
   uint16_t ser[4];
 	HAL_StatusTypeDef error;
 
-	error = hdc1080_read_reg(hi2c, 10, HDC1080_SERIAL_ID1, &ser[0]);
+	error = hdc1080_read_reg(hi2c, 0, HDC1080_SERIAL_ID1, &ser[0]);
 	if (error != HAL_OK) return error;
 	
-	error = hdc1080_read_reg(hi2c, 10, HDC1080_SERIAL_ID2, &ser[1]);
+	error = hdc1080_read_reg(hi2c, 0, HDC1080_SERIAL_ID2, &ser[1]);
 	if (error != HAL_OK) return error;
 	
-	error = hdc1080_read_reg(hi2c, 10, HDC1080_SERIAL_ID3, &ser[2]);
+	error = hdc1080_read_reg(hi2c, 0, HDC1080_SERIAL_ID3, &ser[2]);
 	if (error != HAL_OK) return error;
 	
 	ser[3] = 0;
 	memcpy(serial, ser, 8);
 	
-	error = hdc1080_read_reg(hi2c, 10, HDC1080_ID_MANU, manuf);
+	error = hdc1080_read_reg(hi2c, 0, HDC1080_ID_MANU, manuf);
 	if (error != HAL_OK) return error;
 
-	error = hdc1080_read_reg(hi2c, 10, HDC1080_ID_DEV, device);
+	error = hdc1080_read_reg(hi2c, 0, HDC1080_ID_DEV, device);
 	if (error != HAL_OK) return error;
 	
 	return HAL_OK;  /* Success */
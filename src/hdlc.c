@@ -13,17 +13,40 @@
 /* Includes ------------------------------------------------------------------*/
 #include "stm32f0xx.h"          // Device header, mostly for uintX_t defines
 #include "hdlc.h"								// header for this HDLC implementation
-#include <string.h>							// memcpy()
+#include <string.h>							// memset(), memmove()
 #include "crc.h"
 
 
 // Basic setup constants, define for debugging and skip CRC checking, too...
 #include "setup.h"
 
+#ifdef SETUP_RX_PROBE
+#define HDLC_PROBE_ON()		HAL_GPIO_WritePin(GPIOA, GPIO_PIN_6, GPIO_PIN_SET)
+#define HDLC_PROBE_OFF()	HAL_GPIO_WritePin(GPIOA, GPIO_PIN_6, GPIO_PIN_RESET)
+#else
+#define HDLC_PROBE_ON()
+#define HDLC_PROBE_OFF()
+#endif
 
-__weak void uart_putchar(char ch)
+
+__weak void uart_write(const uint8_t *buf, uint16_t len)
+{
+	// implement function to start sending buffer via UART
+}
+
+__weak void uart_tx_wait(void)
 {
-	// implement function to send character via UART
+	// implement function to wait until previous uart_write() is done
+}
+
+__weak void uart_rx_mute(void)
+{
+	// implement function to ignore receiver until addressed again
+}
+
+__weak void uart_baud_keepalive(void)
+{
+	// implement function to note that the line carries valid frames
 }
 
 //extern void uart_putchar(char ch);
@@ -35,64 +58,145 @@ __weak int16_t payload_processor(hdlc_t *hdlc)
 	return 0;
 }
 
+typedef struct
+{
+	uint16_t			len;
+	uint8_t				buf[HDLC_SLOT_SIZE];
+} hdlc_frame_t;
+
+HDLC_STATIC_ASSERT((HDLC_RX_QUEUE & (HDLC_RX_QUEUE - 1)) == 0, rx_queue_power_of_2);
+HDLC_STATIC_ASSERT(HDLC_SLOT_SIZE <= HDLC_TX_MTU, slot_fits_wire_buffer);
+
 static hdlc_t		hdlc;
 
 // Static buffer allocations
-static uint8_t  _hdlc_rx_frame[HDLC_MRU];   // rx frame buffer allocation
-static uint8_t  _hdlc_tx_frame[HDLC_MRU];   // tx frame buffer allocation
-static uint8_t  _hdlc_payload[HDLC_MRU];    // payload buffer allocation
-
+static hdlc_frame_t  _hdlc_rx_queue[HDLC_RX_QUEUE];  // rx frames, reply is built in place
+static uint8_t  _hdlc_tx_wire[2*(HDLC_TX_MTU+2)+2];  // escaped frame with flags, sent by DMA
 
-/** Private functions to send bytes via UART */
-/* Send a byte via uart_putchar() function */
-static void hdlc_tx_byte(uint8_t byte)
-{
-	HAL_GPIO_WritePin(GPIOA, GPIO_PIN_5, GPIO_PIN_SET );
-  uart_putchar((char)byte);
-	HAL_GPIO_WritePin(GPIOA, GPIO_PIN_5, GPIO_PIN_RESET );
-}
 
-/* Check and send a byte with hdlc ESC sequence via UART */
-static void hdlc_esc_tx_byte(uint8_t byte)
+/** Private functions to assemble escaped frame for UART */
+/* Put a byte with hdlc ESC sequence to wire buffer at index n, return new index */
+static uint16_t hdlc_esc_tx_byte(uint16_t n, uint8_t byte)
 {
 	if((byte == HDLC_CONTROL_ESCAPE) || (byte == HDLC_FLAG_SOF))
 	{
-		hdlc_tx_byte(HDLC_CONTROL_ESCAPE);
+		_hdlc_tx_wire[n++] = HDLC_CONTROL_ESCAPE;
 		byte ^= HDLC_ESCAPE_BIT;
-		hdlc_tx_byte(byte);
 	}
-	else 
-		hdlc_tx_byte(byte);
+	_hdlc_tx_wire[n++] = byte;
+	return n;
+}
+
+/* Put CRC and closing flag after the frame and start sending */
+static void hdlc_tx_wire(uint16_t n, uint16_t crc)
+{
+	n = hdlc_esc_tx_byte(n, (uint8_t)((crc>>8)&0xff));  // CRC MSB with esc check
+	n = hdlc_esc_tx_byte(n, (uint8_t)(crc&0xff));       // CRC LSB with esc check
+	_hdlc_tx_wire[n++] = HDLC_FLAG_SOF; 		// flag - stop frame
+	uart_write(_hdlc_tx_wire, n);
 }
 
 
 /* initialiyatiuon of the HDLC state machine, buffer pointers and status variables */
 void hdlc_init(void)
 {
+	memset(&hdlc, 0, sizeof(hdlc));
+	memset(_hdlc_rx_queue, 0, sizeof(_hdlc_rx_queue));
   hdlc.rx_frame_index = 0;
-  hdlc.rx_frame_fcs   = HDLC_CRC_INIT_VAL;
-	hdlc.p_rx_frame 	  = _hdlc_rx_frame;
-	memset(hdlc.p_rx_frame, 0, HDLC_MRU);
-	hdlc.p_tx_frame 	  = _hdlc_tx_frame;
-	memset(hdlc.p_tx_frame, 0, HDLC_MRU);
-	hdlc.p_payload 	    = _hdlc_payload;
-	memset(hdlc.p_payload, 0, HDLC_MRU);
+  hdlc.rx_frame_fcs   = CRC16_INIT_VAL;
+	hdlc.p_rx_frame 	  = _hdlc_rx_queue[0].buf;
+	hdlc.p_tx_frame 	  = _hdlc_rx_queue[0].buf;
+	hdlc.p_payload 	    = _hdlc_rx_queue[0].buf+3;
 	hdlc.state					= HDLC_SOF_WAIT;
 	hdlc.own_addr				= SETUP_OWNADDRESS;
 }
 
 
-/* This function should be called when new character is received via UART */
+/* Drop partly received frame and wait for the next flag, queued frames stay */
+void hdlc_rx_reset(void)
+{
+	hdlc.rx_frame_index = 0;
+	hdlc.rx_frame_fcs   = CRC16_INIT_VAL;
+	hdlc.state					= HDLC_SOF_WAIT;
+}
+
+
+/* Start reception of next frame to free queue slot, no slot when queue is full */
+static void hdlc_rx_restart(void)
+{
+	hdlc.rx_frame_index = 0;
+	hdlc.rx_frame_fcs   = CRC16_INIT_VAL;
+	if ((uint8_t)(hdlc.rx_head - hdlc.rx_tail) < HDLC_RX_QUEUE)
+		hdlc.p_rx_frame = _hdlc_rx_queue[hdlc.rx_head % HDLC_RX_QUEUE].buf;
+	else
+		hdlc.p_rx_frame = NULL;
+	hdlc.state = HDLC_DATARX;
+}
+
+
+/* Store received byte, drop foreign frame as soon as its destination is known */
+static void hdlc_rx_store(uint8_t rx_byte)
+{
+	if (hdlc.rx_frame_index >= HDLC_MRU) // frame overrun
+	{
+		hdlc.state = HDLC_SKIP;   // drop frame and start over at next flag
+		hdlc.rx_dropped++;
+	}
+	else if (hdlc.rx_frame_index == 1)
+	{
+		if ((rx_byte != hdlc.own_addr) && (rx_byte != HDLC_BROADCAST_ADDR))
+		{
+			hdlc.state = HDLC_SKIP;
+			hdlc.rx_skipped++;
+		}
+		else if (hdlc.p_rx_frame == NULL)  // no free slot
+		{
+			hdlc.state = HDLC_SKIP;
+			hdlc.rx_dropped++;
+		}
+	}
+	if ((hdlc.state == HDLC_DATARX) && (hdlc.p_rx_frame != NULL))
+		hdlc.p_rx_frame[hdlc.rx_frame_index] = rx_byte;
+	hdlc.rx_frame_index++;
+	hdlc.rx_frame_fcs = crc16_update(hdlc.rx_frame_fcs, rx_byte);
+}
+
+
+/* Complete frame received, queue it for hdlc_process() */
+static void hdlc_rx_queue(void)
+{
+	uint8_t depth;
+	
+	#ifndef __SKIPCRC__
+	if (hdlc.rx_frame_fcs != CRC16_RESIDUE)
+	{
+		hdlc.rx_crc_errors++;
+		return;
+	}
+	#endif
+	uart_baud_keepalive();
+	hdlc.rx_frames++;
+	_hdlc_rx_queue[hdlc.rx_head % HDLC_RX_QUEUE].len = hdlc.rx_frame_index;
+	__DMB();    // frame is in place before consumer can see it
+	hdlc.rx_head++;
+	
+	depth = hdlc.rx_head - hdlc.rx_tail;
+	if (depth > hdlc.rx_queue_max)
+		hdlc.rx_queue_max = depth;
+}
+
+
+/* This function should be called when new character is received via UART,
+   in interrupt context it only has to be serialized with itself */
 void hdlc_process_rx_byte(uint8_t rx_byte)
 {
-	HAL_GPIO_WritePin(GPIOA, GPIO_PIN_6, GPIO_PIN_SET );
+	HDLC_PROBE_ON();
 	switch (hdlc.state)
 	{
 		case HDLC_SOF_WAIT:   /// Waiting for SOF flag
 			if (rx_byte == HDLC_FLAG_SOF) 
 			{
-				hdlc_init();
-				hdlc.state = HDLC_DATARX;
+				hdlc_rx_restart();
 			}
 		break;
 			
@@ -108,36 +212,70 @@ void hdlc_process_rx_byte(uint8_t rx_byte)
 				if (hdlc.rx_frame_index == 0) // sof after sof ... drop and continue
 					break;
 				if (hdlc.rx_frame_index > 5) // at least addresses + crc
-				  hdlc_process_rx_frame(hdlc.p_rx_frame, hdlc.rx_frame_index);
-				hdlc_init();
-				hdlc.state = HDLC_DATARX;
-			} else // "normal" - not ESCaped byte
-			{
-				if (hdlc.rx_frame_index < HDLC_MRU) 
-				{
-					hdlc.p_rx_frame[hdlc.rx_frame_index] = rx_byte;
-					hdlc.rx_frame_index++;					
-				} else // frame overrun
 				{
-					hdlc_init();   // drop frame and start over
+				  hdlc_rx_queue();
+					uart_rx_mute();   // frame done, wait for next address mark
 				}
+				hdlc_rx_restart();
+			} else // "normal" - not ESCaped byte
+			{
+				hdlc_rx_store(rx_byte);
 			}
 		break;
 			
 		case HDLC_PROC_ESC:  /// process ESCaped byte
 			hdlc.state = HDLC_DATARX; // return to normal reception after this
-		  if (hdlc.rx_frame_index < HDLC_MRU) // check for overrun
+			hdlc_rx_store(rx_byte ^ HDLC_ESCAPE_BIT);  // XOR with ESC bit
+		break;
+		
+		case HDLC_SKIP:      /// foreign or dropped frame, no buffering
+			if (rx_byte == HDLC_FLAG_SOF) // closing flag may open next frame
 			{
-				rx_byte ^= HDLC_ESCAPE_BIT;  // XOR with ESC bit
-				hdlc.p_rx_frame[hdlc.rx_frame_index] = rx_byte;  
-				hdlc.rx_frame_index++;
-			} else // frame overrun
+				// any valid frame on the line keeps the negotiated rate
+				if ((hdlc.rx_frame_index > 5) && (hdlc.rx_frame_fcs == CRC16_RESIDUE))
+					uart_baud_keepalive();
+				hdlc_rx_restart();
+			}
+			else if (rx_byte == HDLC_CONTROL_ESCAPE)
+			{
+				hdlc.state = HDLC_SKIP_ESC;
+			}
+			else
 			{
-				hdlc_init();  // drop frame and start over
+				hdlc.rx_frame_index++;
+				hdlc.rx_frame_fcs = crc16_update(hdlc.rx_frame_fcs, rx_byte);
 			}
 		break;
+		
+		case HDLC_SKIP_ESC:
+			hdlc.state = HDLC_SKIP;
+			hdlc.rx_frame_index++;
+			hdlc.rx_frame_fcs = crc16_update(hdlc.rx_frame_fcs, rx_byte ^ HDLC_ESCAPE_BIT);
+		break;
+	}
+	HDLC_PROBE_OFF();
+}
+
+/* Process a block of received characters */
+void hdlc_process_rx(const uint8_t *buf, uint16_t len)
+{
+	while (len--)
+		hdlc_process_rx_byte(*buf++);
+}
+
+/* Execute queued frames, call from main loop */
+void hdlc_process(void)
+{
+	hdlc_frame_t *f;
+	
+	while (hdlc.rx_tail != hdlc.rx_head)
+	{
+		f = &_hdlc_rx_queue[hdlc.rx_tail % HDLC_RX_QUEUE];
+		hdlc.p_tx_frame = f->buf;    // reply goes out of the same slot
+		hdlc_process_rx_frame(f->buf, f->len);
+		__DMB();    // done with slot before decoder can reuse it
+		hdlc.rx_tail++;
 	}
-	HAL_GPIO_WritePin(GPIOA, GPIO_PIN_6, GPIO_PIN_RESET );
 }
 
 /** Process received frame buf with length len
@@ -148,6 +286,7 @@ void hdlc_process_rx_byte(uint8_t rx_byte)
 		[payload]								// 1 or more bytes of payload data
 		[crc16-H]								// MSB of CRC16
 		[crc16-L]								// LSB of CRC16
+	CRC is checked by the byte state machine before the frame is queued.
 */
 void hdlc_process_rx_frame(uint8_t *buf, uint16_t len)
 {
@@ -158,24 +297,17 @@ void hdlc_process_rx_frame(uint8_t *buf, uint16_t len)
 		hdlc.ctrl = buf[2];				// HDLC Ctrl byte
 		
 		// Is the received packet for this device and has proper ctrl ?
-		if ((hdlc.dest_addr == SETUP_OWNADDRESS) & (hdlc.ctrl == (HDLC_UI_CMD | HDLC_POLL_FLAG)))
+		if (((hdlc.dest_addr == SETUP_OWNADDRESS) | (hdlc.dest_addr == HDLC_BROADCAST_ADDR)) & 
+			  (hdlc.ctrl == (HDLC_UI_CMD | HDLC_POLL_FLAG)))
 		{
-		  // process only frame where destination address matches own address
-			hdlc.rx_frame_fcs = (uint16_t)(buf[len-2]<<8) | (uint16_t)(buf[len-1]);
-			if (len>5)
-			{  // copy payload
-				memcpy(hdlc.p_payload,hdlc.p_rx_frame+3,len-5);
-			}
-			#ifndef __SKIPCRC__
-			if (crc16(buf, len-2) == hdlc.rx_frame_fcs)
-			#endif
+		  // process only frame where destination address matches own or broadcast address
+			hdlc.payload_len = len-5;
+			hdlc.p_payload = buf+3;   // payload stays in the frame buffer
+			// process received payload
+			len = payload_processor(&hdlc);
+			if ((len > 0) & (hdlc.dest_addr != HDLC_BROADCAST_ADDR))  // all nodes would answer at once
 			{
-				// process received payload
-				len = payload_processor(&hdlc);
-				if (len > 0)
-				{
-					hdlc_tx_frame(hdlc.p_payload, len);
-				}
+				hdlc_tx_frame(hdlc.p_payload, len);
 			}
 		}		
 	}
@@ -230,30 +362,30 @@ void hdlc_process_rx_frame(uint8_t *buf, uint16_t len)
 void hdlc_tx_frame(const uint8_t *txbuffer, uint8_t len)
 {
 	//uint8_t  byte;
-	uint16_t crc, i;
+	uint16_t crc, i, n;
 
+	if (len+3 > HDLC_SLOT_SIZE)   // header and payload are assembled in the rx slot
+		return;
+	
+	// previous frame may still be going out of the wire buffer
+	uart_tx_wait();
+	
 	// Prepare Tx buffer
+	if (txbuffer != hdlc.p_tx_frame+3)   // reply built in place needs no copy
+		memmove(hdlc.p_tx_frame+3, txbuffer, len);
 	hdlc.p_tx_frame[0] = hdlc.own_addr;
 	hdlc.p_tx_frame[1] = hdlc.src_addr;
 	hdlc.p_tx_frame[2] = HDLC_UI_CMD | HDLC_FINAL_FLAG;
 	
-	for (i=0; i<len; i++)
-	{
-		hdlc.p_tx_frame[3+i] = *txbuffer++;
-	}
-	
-	// Calculate CRC
-	crc = crc16(hdlc.p_tx_frame, len+3);
-	
-	// Send/escaped buffer
+	// Calculate CRC and escape buffer in one pass, send it in one go
+	crc = CRC16_INIT_VAL;
+	n = 0;
 	for (i=0; i<len+3; i++)
 	{
-		hdlc_esc_tx_byte(hdlc.p_tx_frame[i]);		// Send byte with esc checking
+		crc = crc16_update(crc, hdlc.p_tx_frame[i]);
+		n = hdlc_esc_tx_byte(n, hdlc.p_tx_frame[i]);		// byte with esc checking
 	}
-		
-	hdlc_esc_tx_byte((uint8_t)((crc>>8)&0xff));  // Send CRC MSB with esc check
-	hdlc_esc_tx_byte((uint8_t)(crc&0xff));      // Send CRC LSB with esc check
-	hdlc_tx_byte(HDLC_FLAG_SOF); 		// Send flag - stop frame
+	hdlc_tx_wire(n, crc);
 }
 
 
@@ -261,19 +393,23 @@ void hdlc_tx_frame(const uint8_t *txbuffer, uint8_t len)
 void hdlc_tx_raw_frame(const uint8_t *txbuffer, uint8_t len)
 {
 	uint8_t  byte;
-	uint16_t crc = crc16(txbuffer, len);
+	uint16_t crc, n;
+	
+	if (len > HDLC_TX_MTU)
+		return;
 	
-	hdlc_tx_byte(HDLC_FLAG_SOF); 			// Send flag - indicate start of frame
+	crc = crc16(txbuffer, len);
+	uart_tx_wait();
+	
+	n = 0;
+	_hdlc_tx_wire[n++] = HDLC_FLAG_SOF; 			// flag - indicate start of frame
 	while(len)
 	{
 		byte = *txbuffer++; 	// Get next byte from buffer
-		hdlc_esc_tx_byte(byte);		// Send byte with esc checking
+		n = hdlc_esc_tx_byte(n, byte);		// byte with esc checking
 		len--;
 	}
-	
-	hdlc_esc_tx_byte((uint8_t)((crc>>8)&0xff));  // Send CRC MSB with esc check
-	hdlc_esc_tx_byte((uint8_t)(crc&0xff));      // Send CRC LSB with esc check
-	hdlc_tx_byte(HDLC_FLAG_SOF); 		// Send flag - stop frame
+	hdlc_tx_wire(n, crc);
 }
 
 
@@ -0,0 +1,183 @@
+/**
+  ******************************************************************************
+  * File Name          : i2c_bus.c
+  * Description        : Interrupt driven I2C transfer queue
+  ******************************************************************************
+  *
+  * Copyright (c) 2016 S54MTB
+  * Licensed under Apache License 2.0 
+  * http://www.apache.org/licenses/LICENSE-2.0.html
+  *
+  ******************************************************************************
+  
+  Transfers for both sensors are queued and run one after another with 
+  HAL_I2C_Master_xxx_IT() calls, the next one is started from the completion
+  interrupt. A NACK ends the transfer at once with HAL_ERROR, a transfer 
+  that does not complete in time is dropped with HAL_TIMEOUT and the 
+  peripheral is reinitialized. All transfers must use the same I2C handle.
+  */
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f0xx_hal.h"
+#include "i2c_bus.h"
+
+static i2c_xfer_t * volatile	head = NULL;		// running transfer
+static i2c_xfer_t * volatile	tail = NULL;		// last queued transfer
+
+static void i2c_bus_complete(HAL_StatusTypeDef status);
+
+
+/* Start transfer at the head of the queue */
+static void i2c_bus_start(i2c_xfer_t *x)
+{
+	HAL_StatusTypeDef error;
+	
+	x->tstart = HAL_GetTick();
+	if (x->txlen > 0)
+		error = HAL_I2C_Master_Transmit_IT(x->hi2c, x->addr<<1, x->tx, x->txlen);
+	else
+		error = HAL_I2C_Master_Receive_IT(x->hi2c, x->addr<<1 | 0x01, x->rx, x->rxlen);
+	if (error != HAL_OK)
+		i2c_bus_complete(error);
+}
+
+
+/* Finish transfer at the head of the queue and start the next one */
+static void i2c_bus_complete(HAL_StatusTypeDef status)
+{
+	i2c_xfer_t *x = head;
+	
+	head = x->next;
+	if (head == NULL)
+		tail = NULL;
+	
+	x->status = status;
+	if (x->callback != NULL)
+		x->callback(x);
+	
+	if (head != NULL)
+		i2c_bus_start(head);
+}
+
+
+/*
+ * i2c_bus_submit() - Queue transfer
+ * @xfer:  transfer, must stay valid until xfer->status is not HAL_BUSY
+ * Returns HAL_ERROR for empty transfer, HAL_OK when queued.
+ */
+HAL_StatusTypeDef i2c_bus_submit(i2c_xfer_t *xfer)
+{
+	if ((xfer->txlen == 0) & (xfer->rxlen == 0))
+		return HAL_ERROR;
+	
+	xfer->status = HAL_BUSY;
+	xfer->next = NULL;
+	
+	__disable_irq();
+	if (tail != NULL)
+	{
+		tail->next = xfer;
+		tail = xfer;
+	}
+	else
+	{
+		head = xfer;
+		tail = xfer;
+		i2c_bus_start(xfer);
+	}
+	__enable_irq();
+	
+	return HAL_OK;
+}
+
+
+/* Check running transfer for timeout, call from main loop */
+void i2c_bus_process(void)
+{
+	i2c_xfer_t *x;
+	
+	__disable_irq();
+	x = head;
+	if ((x != NULL) && ((HAL_GetTick() - x->tstart) > x->timeout))
+	{
+		// stuck bus or peripheral, start over
+		HAL_I2C_DeInit(x->hi2c);
+		HAL_I2C_Init(x->hi2c);
+		i2c_bus_complete(HAL_TIMEOUT);
+	}
+	__enable_irq();
+}
+
+
+/*
+ * i2c_bus_transfer() - Write and/or read and wait for completion
+ * @hi2c:  handle to I2C interface
+ * @addr:  7-bit slave address
+ * @tx, @txlen: data to write first, txlen may be 0
+ * @rx, @rxlen: buffer for data to read, rxlen may be 0
+ *
+ * The core sleeps while bytes are clocked out, UART and tick interrupts
+ * are served meanwhile.
+ * Returns HAL status of the transfer.
+ */
+HAL_StatusTypeDef i2c_bus_transfer(I2C_HandleTypeDef *hi2c, uint16_t addr, uint8_t *tx, uint16_t txlen, uint8_t *rx, uint16_t rxlen)
+{
+	i2c_xfer_t x;
+	
+	x.hi2c = hi2c;
+	x.addr = addr;
+	x.tx = tx;
+	x.txlen = txlen;
+	x.rx = rx;
+	x.rxlen = rxlen;
+	x.timeout = I2C_BUS_TIMEOUT;
+	x.callback = NULL;
+	
+	if (i2c_bus_submit(&x) != HAL_OK)
+		return HAL_ERROR;
+	
+	while (x.status == HAL_BUSY)
+	{
+		__disable_irq();
+		if (x.status == HAL_BUSY)
+			__WFI();        // pending interrupt wakes the core even when masked
+		__enable_irq();
+		i2c_bus_process();
+	}
+	return x.status;
+}
+
+
+/* HAL callbacks ------------------------------------------------------------*/
+
+void HAL_I2C_MasterTxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+	i2c_xfer_t *x = head;
+	
+	if (x == NULL)
+		return;
+	if (x->rxlen > 0)   // continue with read part
+	{
+		if (HAL_I2C_Master_Receive_IT(hi2c, x->addr<<1 | 0x01, x->rx, x->rxlen) != HAL_OK)
+			i2c_bus_complete(HAL_ERROR);
+	}
+	else
+		i2c_bus_complete(HAL_OK);
+}
+
+
+void HAL_I2C_MasterRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+	if (head != NULL)
+		i2c_bus_complete(HAL_OK);
+}
+
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+{
+	// NACK is reported once more with STOP, finish on the last report only
+	if ((head != NULL) & (hi2c->State == HAL_I2C_STATE_READY))
+		i2c_bus_complete(HAL_ERROR);
+}
+
+
+/* Copyright (c) 2016 S54MTB			********* End Of File   ********/
@@ -13,6 +13,8 @@
 /* Includes ------------------------------------------------------------------*/
 #include "stm32f0xx_hal.h"
 #include "hdlc.h"
+#include "sampler.h"
+#include "i2c_bus.h"
 #include <string.h>
 #include "serial.h"
 #include "setup.h"
@@ -22,10 +24,13 @@
 I2C_HandleTypeDef hi2c1;
 
 UART_HandleTypeDef huart2;
+DMA_HandleTypeDef hdma_usart2_rx;
+DMA_HandleTypeDef hdma_usart2_tx;
 
 /* Private function prototypes -----------------------------------------------*/
 void SystemClock_Config(void);
 static void MX_GPIO_Init(void);
+static void MX_DMA_Init(void);
 static void MX_I2C1_Init(void);
 static void MX_USART2_UART_Init(void);
 void MX_NVIC_Init(void);
@@ -69,8 +74,6 @@ void MX_NVIC_Init(void);
 
 int main(void)
 {
- 	uint8_t aRxBuffer;
-
   /* MCU Configuration----------------------------------------------------------*/
   /* Reset of all peripherals, Initializes the Flash interface and the Systick. */
   HAL_Init();
@@ -80,6 +83,7 @@ int main(void)
 
   /* Initialize all configured peripherals */
   MX_GPIO_Init();
+  MX_DMA_Init();
   MX_I2C1_Init();
   MX_USART2_UART_Init();
 
@@ -87,12 +91,17 @@ int main(void)
   MX_NVIC_Init();
 
 	hdlc_init();
+	uart_rx_start();
+	sampler_init();
 
 	//test();
 	
   while (1)
   {
-		if (HAL_UART_Receive_IT(&huart2, &aRxBuffer, 1) == HAL_OK) process_rx_char(aRxBuffer);  
+		hdlc_process();
+		uart_baud_process();
+		sampler_process();
+		i2c_bus_process();
   }
 
 }
@@ -141,6 +150,22 @@ void MX_NVIC_Init(void)
   /* USART2_IRQn interrupt configuration */
   HAL_NVIC_SetPriority(USART2_IRQn, 0, 0);
   HAL_NVIC_EnableIRQ(USART2_IRQn);
+  /* I2C1_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(I2C1_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(I2C1_IRQn);
+}
+
+/** 
+  * Enable DMA controller clock
+  */
+void MX_DMA_Init(void) 
+{
+  /* DMA controller clock enable */
+  __HAL_RCC_DMA1_CLK_ENABLE();
+
+  /* DMA interrupt init */
+  HAL_NVIC_SetPriority(DMA1_Channel4_5_IRQn, 0, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Channel4_5_IRQn);
 }
 
 /* I2C1 init function */
@@ -170,7 +195,11 @@ void MX_USART2_UART_Init(void)
 
   huart2.Instance = USART2;
   huart2.Init.BaudRate = SETUP_BAUDRATE;
+#ifdef SETUP_MUTEMODE
+  huart2.Init.WordLength = UART_WORDLENGTH_9B;		// 9th bit is address mark
+#else
   huart2.Init.WordLength = UART_WORDLENGTH_8B;
+#endif
   huart2.Init.StopBits = UART_STOPBITS_1;
   huart2.Init.Parity = UART_PARITY_NONE;
   huart2.Init.Mode = UART_MODE_TX_RX;
@@ -178,7 +207,7 @@ void MX_USART2_UART_Init(void)
   huart2.Init.OverSampling = UART_OVERSAMPLING_16;
   huart2.Init.OneBitSampling = UART_ONE_BIT_SAMPLE_DISABLE;
   huart2.AdvancedInit.AdvFeatureInit = UART_ADVFEATURE_NO_INIT;
-  HAL_RS485Ex_Init(&huart2, UART_DE_POLARITY_HIGH, 0, 0);
+  HAL_RS485Ex_Init(&huart2, UART_DE_POLARITY_HIGH, SETUP_DE_ASSERT, SETUP_DE_DEASSERT);
 
 }
 
@@ -5,8 +5,8 @@
 #include "payload_processor.h"
 #include "setup.h"
 #include "hdlc.h"
-#include "MS5637.h"
-#include "hdc1080.h"
+#include "sampler.h"
+#include "serial.h"
 
 
 enum
@@ -20,88 +20,241 @@ enum
 	CMD_pD1,       					/// Raw pressure readout from pressure sensor
 	CMD_pD2,       					/// Raw temperature from pressure sensor
 	CMD_ID,									/// Identification
+	CMD_pCALReload,					/// Re-read calibration coefficients from pressure sensor
+	CMD_All,								/// All quantities from one sample in compact form
+	CMD_Stats,							/// HDLC receive counters and queue depth
+	CMD_Baud,								/// Query or change link rate
+	CMD_Trigger,						/// Start and latch a sample set, no reply (broadcast)
+	CMD_Collect,						/// Latched sample set in CMD_All form
 };
 
+#define CMD_ALL_VERSION		1		// layout version of CMD_All reply
+#define CMD_COMPACT				0x80	// command flag: fixed point reply instead of double
+#define CMD_COMPACT_VERSION	1		// layout version of compact replies
+#define CMD_SAMPLE_LEN		14		// sample set in CMD_All layout, see put_sample()
+
+// Longest request and replies must fit the HDLC frame slots
+HDLC_STATIC_ASSERT(1+4 <= HDLC_MAX_REQUEST, baud_request);
+HDLC_STATIC_ASSERT(1+sizeof(double)+3 <= HDLC_MAX_REPLY, value_reply);
+HDLC_STATIC_ASSERT(1+2*8 <= HDLC_MAX_REPLY, pcal_reply);
+HDLC_STATIC_ASSERT(1+2+CMD_SAMPLE_LEN <= HDLC_MAX_REPLY, collect_reply);
+HDLC_STATIC_ASSERT(1+4*2+2 <= HDLC_MAX_REPLY, stats_reply);
+
 extern I2C_HandleTypeDef hi2c1;
 extern UART_HandleTypeDef huart2;
 
+
+/* Append 16-bit value, LSB first */
+static int16_t put_u16(uint8_t *buf, uint16_t val)
+{
+	buf[0] = (uint8_t)(val & 0xff);
+	buf[1] = (uint8_t)(val >> 8);
+	return 2;
+}
+
+
+/* Append 24-bit value, LSB first */
+static int16_t put_u24(uint8_t *buf, uint32_t val)
+{
+	buf[0] = (uint8_t)(val & 0xff);
+	buf[1] = (uint8_t)((val >> 8) & 0xff);
+	buf[2] = (uint8_t)((val >> 16) & 0xff);
+	return 3;
+}
+
+
+/* Append 32-bit value, LSB first */
+static int16_t put_u32(uint8_t *buf, uint32_t val)
+{
+	put_u16(buf, (uint16_t)(val & 0xffff));
+	put_u16(&buf[2], (uint16_t)(val >> 16));
+	return 4;
+}
+
+
+/* 
+ * Append value given in 0.01 units (Pa for pressure): compact form is 
+ * version and LSB first integer of size bytes, legacy form a raw double 
+ */
+static int16_t put_value(uint8_t *buf, int32_t val, uint8_t size, uint8_t compact)
+{
+	double d;
+	
+	if (compact)
+	{
+		buf[0] = CMD_COMPACT_VERSION;
+		if (size == 3) return 1+put_u24(&buf[1], (uint32_t)val);
+		return 1+put_u16(&buf[1], (uint16_t)val);
+	}
+	d = val / 100.0;
+	memcpy(buf, &d, sizeof(double));
+	return sizeof(double);
+}
+
+
+/* Append age of the sample in ms, LSB first */
+static int16_t put_age(uint8_t *buf)
+{
+	return put_u16(buf, sampler_age());
+}
+
+
+/* Append sample set in CMD_All layout */
+static int16_t put_sample(uint8_t *buf, const sampler_snapshot_t *s, uint16_t age)
+{
+	int16_t len;
+	
+	buf[0] = CMD_ALL_VERSION;
+	buf[1] = s->valid;
+	len=2;
+	len+=put_u16(&buf[len], (uint16_t)s->temperature);
+	len+=put_u16(&buf[len], s->humidity);
+	buf[len++] = s->bat;
+	len+=put_u24(&buf[len], (uint32_t)s->pressure);
+	len+=put_u16(&buf[len], (uint16_t)s->pTemperature);
+	len+=put_u16(&buf[len], age);
+	return len;
+}
+
+
+/* Append resolution code and age of a fresh (age 0) or background sample */
+static int16_t put_res_age(uint8_t *buf, uint8_t res, uint8_t fresh)
+{
+	buf[0] = res;
+	if (fresh)
+	{
+		buf[1] = 0;
+		buf[2] = 0;
+		return 3;
+	}
+	return 1+put_age(&buf[1]);
+}
+
+
+/* 
+ * Measurement commands are answered from the latest background sample,
+ * followed by the age of that sample in ms (0xffff = no sample yet).
+ *
+ * Optional second payload byte is a latency budget in ms for temperature,
+ * humidity, pressure and pTemperature. The value is then measured fresh at 
+ * the best resolution that fits the budget and the reply carries the used 
+ * resolution code (HDC1080_x_RES_x or MS5637_OSR_x) before the age. If no 
+ * resolution fits, the background sample is returned with its resolution.
+ *
+ * Temperature, humidity, pressure and pTemperature are sent as double by 
+ * default. With CMD_COMPACT (0x80) or-ed into the command byte the value is 
+ * sent in fixed point instead, LSB first: version (CMD_COMPACT_VERSION), 
+ * then int16 0.01 C, uint16 0.01 %RH or uint24 Pa. The reply echoes the 
+ * flagged command byte; resolution and age follow as above.
+ *
+ * CMD_All returns the whole background sample in one reply, LSB first:
+ *   version (1), valid (SAMPLER_VALID_x bits), temperature (int16, 0.01 C),
+ *   humidity (uint16, 0.01 %RH), battery (1), pressure (uint24, Pa),
+ *   pTemperature (int16, 0.01 C), age (uint16, ms)
+ *
+ * CMD_Trigger (normally to HDLC_BROADCAST_ADDR) with optional tag byte 
+ * starts a sample set on every node at once and latches it. CMD_Collect 
+ * then returns tag, latch state (SAMPLER_LATCH_xxx) and, when ready, the 
+ * latched set in CMD_All layout. A whole bus sweep takes one sample set
+ * time plus one short frame per node.
+ *
+ * CMD_Stats returns HDLC receive counters, LSB first: frames, skipped, 
+ * dropped, CRC errors (uint16 each), queued frames and max. queued (1 each)
+ *
+ * CMD_Baud with a 4-byte rate (LSB first) switches the link to that rate 
+ * after the reply, UART_BAUD_AUTO (0) enables auto baud rate detection 
+ * on the next 0x7F character. Without argument it queries the rate.
+ * Reply is status (HAL_OK / HAL_ERROR) and rate. The node falls back to
+ * SETUP_BAUDRATE when no frame with valid CRC, for any node, was on the 
+ * line for SETUP_BAUD_TIMEOUT ms. In mute mode only own frames count.
+ */
 int16_t payload_processor(hdlc_t *hdlc)
 {	
-	uint8_t response[24],i;
+	uint8_t *response = &hdlc->p_payload[1];   // reply goes to tx frame after the command echo
   int16_t len=0;
 	uint32_t uid = UNIQUE_ID;
-	uint16_t Pcal[8];         // calibration constants from MS5637 PROM registers
-	double hum, temp;
-	uint8_t bat; 
-	uint32_t D1 = 0, D2 = 0;  // raw MS5637 pressure and temperature data
-	double Temperature, Pressure; // stores MS5637 pressures sensor pressure and temperature	
+	const sampler_snapshot_t *s = sampler_snapshot();
+	uint8_t budget = 0;           // latency budget in ms, 0 = background sample
+	uint8_t fresh = 0;            // value measured for this request
+	uint8_t tres = SAMPLER_T_RES, rhres = SAMPLER_RH_RES, osr = SAMPLER_OSR;
+	int16_t t = s->temperature;
+	uint16_t rh = s->humidity;
+	int32_t pT = s->pTemperature, p = s->pressure;
+	uint8_t cmd = hdlc->p_payload[0] & ~CMD_COMPACT;
+	uint8_t compact = hdlc->p_payload[0] & CMD_COMPACT;
+	uint32_t baud;
+	HAL_StatusTypeDef status;
+	uint16_t age;
 	
+	if (hdlc->payload_len > 1)
+		budget = hdlc->p_payload[1];
 	
-	// Commands for HDC1080
-	if ((hdlc->p_payload[0] == CMD_Temperature) |
-		  (hdlc->p_payload[0] == CMD_Humidity) |
-		  (hdlc->p_payload[0] == CMD_Bat))
-	{
-		hdc1080_measure(&hi2c1, HDC1080_T_RES_14, HDC1080_RH_RES_14, 0, &bat, &temp, &hum);
-	}
-	
-	// Commands for MS5637
-	if ((hdlc->p_payload[0] == CMD_Pressure) |
-	    (hdlc->p_payload[0] == CMD_pTemperature) |
-	    (hdlc->p_payload[0] == CMD_pCAL) |
-	    (hdlc->p_payload[0] == CMD_pD1) |
-	    (hdlc->p_payload[0] == CMD_pD2) )
+	if (budget > 0)
 	{
-		for (i=0; i<8; i++)
+		if ((cmd == CMD_Temperature) | (cmd == CMD_Humidity))
 		{
-			MS5637_read_PROM(&hi2c1, i, &Pcal[i]); // c1 to c8 --- 
+			fresh = (sampler_measure_hdc1080(budget, cmd == CMD_Humidity, 
+			                                 &tres, &rhres, &t, &rh) == HAL_OK);
+		}
+		if ((cmd == CMD_Pressure) | (cmd == CMD_pTemperature))
+		{
+			fresh = (sampler_measure_pressure(budget, &osr, &pT, &p) == HAL_OK);
+		}
+		if (!fresh)   // back to background sample and its resolution
+		{
+			tres = SAMPLER_T_RES; rhres = SAMPLER_RH_RES; osr = SAMPLER_OSR;
+			t = s->temperature; rh = s->humidity;
+			pT = s->pTemperature; p = s->pressure;
 		}
-		
-		MS5637_read_ADC_TP(&hi2c1, MS5637_CONVERT_D1_BASE, MS5637_OSR_8192, &D1);  // D1
-		MS5637_read_ADC_TP(&hi2c1, MS5637_CONVERT_D2_BASE, MS5637_OSR_8192, &D2);  // D2
-		MS5637_Calculate(Pcal, D1, D2, &Temperature, &Pressure);
 	}
-	 
-	switch (hdlc->p_payload[0])
+	
+	switch (cmd)
 	{
 		case CMD_Temperature :			
-		  memcpy(response, &temp, sizeof(double));
-			len=sizeof(double)+1;
+			len=put_value(response, t, 2, compact)+1;
+			if (budget) len+=put_res_age(&response[len-1], tres, fresh);
+			else len+=put_age(&response[len-1]);
 		break;
 		
 		case CMD_Humidity :
-		  memcpy(response, &hum, sizeof(double));
-			len=sizeof(double)+1;
+			len=put_value(response, rh, 2, compact)+1;
+			if (budget) len+=put_res_age(&response[len-1], rhres, fresh);
+			else len+=put_age(&response[len-1]);
 		break;
 		
     case CMD_Bat:
-		  response[0] = bat;
+		  response[0] = s->bat;
 			len=2;			
+			len+=put_age(&response[len-1]);
 		break;
 		
     case CMD_Pressure:
-		  memcpy(response, &Pressure, sizeof(double));
-			len=sizeof(double)+1;
+			len=put_value(response, p, 3, compact)+1;
+			if (budget) len+=put_res_age(&response[len-1], osr, fresh);
+			else len+=put_age(&response[len-1]);
 		break;
 		
 		case CMD_pTemperature:
-		  memcpy(response, &Temperature, sizeof(double));
-			len=sizeof(double)+1;
+			len=put_value(response, pT, 2, compact)+1;
+			if (budget) len+=put_res_age(&response[len-1], osr, fresh);
+			else len+=put_age(&response[len-1]);
 		break;
 		
 		case CMD_pCAL:
-		  memcpy(response, Pcal, 2*8);
+		  memcpy(response, sampler_calibration()->C, 2*8);
 			len=2*8+1;
 		break;
 		
 		case CMD_pD1:
-		  memcpy(response, &D1, 2);
+		  memcpy(response, &s->D1, 2);
 			len=2+1;
+			len+=put_age(&response[len-1]);
 		break;
 		
 		case CMD_pD2:
-		  memcpy(response, &D2, 2);
+		  memcpy(response, &s->D2, 2);
 			len=2+1;
+			len+=put_age(&response[len-1]);
 		break;
 		
 		case CMD_ID:
@@ -109,9 +262,56 @@ int16_t payload_processor(hdlc_t *hdlc)
 			len=6;						
 		break;	
 		
+		case CMD_pCALReload:
+		  response[0] = sampler_reload_calibration();
+			len=2;
+		break;
+		
+		case CMD_All:
+			len=put_sample(response, s, sampler_age());
+			len++;    // command byte
+		break;
+		
+		case CMD_Trigger:
+			sampler_trigger((hdlc->payload_len > 1) ? hdlc->p_payload[1] : 0);
+			len=0;    // no reply, also when addressed
+		break;
+		
+		case CMD_Collect:
+			response[1] = sampler_collect(&response[0], &s, &age);
+			len=2;
+			if (response[1] == SAMPLER_LATCH_READY)
+				len+=put_sample(&response[len], s, age);
+			len++;    // command byte
+		break;
+		
+		case CMD_Stats:
+			len=0;
+			len+=put_u16(&response[len], hdlc->rx_frames);
+			len+=put_u16(&response[len], hdlc->rx_skipped);
+			len+=put_u16(&response[len], hdlc->rx_dropped);
+			len+=put_u16(&response[len], hdlc->rx_crc_errors);
+			response[len++] = (uint8_t)(hdlc->rx_head - hdlc->rx_tail);
+			response[len++] = hdlc->rx_queue_max;
+			len++;    // command byte
+		break;
+		
+		case CMD_Baud:
+			baud = uart_baudrate();
+			status = HAL_OK;
+			if (hdlc->payload_len >= 5)
+			{
+				baud = hdlc->p_payload[1] | (hdlc->p_payload[2] << 8) | 
+				       ((uint32_t)hdlc->p_payload[3] << 16) | ((uint32_t)hdlc->p_payload[4] << 24);
+				status = uart_baud_request(baud);
+			}
+			response[0] = status;    // overwrites the first rate byte
+			len=1;
+			len+=put_u32(&response[len], baud);
+			len++;    // command byte
+		break;
+		
 	}
-	
-	for (i=0; i<len; i++) hdlc->p_payload[i+1]=response[i];
 
 	return len;
 }
@@ -119,3 +319,6 @@ int16_t payload_processor(hdlc_t *hdlc)
 
 
 
+
+
+
@@ -0,0 +1,388 @@
+/**
+  ******************************************************************************
+  * File Name          : sampler.c
+  * Description        : Background sensor sampling
+  ******************************************************************************
+  *
+  * Copyright (c) 2016 S54MTB
+  * Licensed under Apache License 2.0 
+  * http://www.apache.org/licenses/LICENSE-2.0.html
+  *
+  ******************************************************************************
+  
+  Sensors are sampled periodically from the main loop and the results are
+  kept in a snapshot. Commands are answered from the snapshot, so a poll 
+  does not have to wait for sensor conversions.
+  */
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f0xx_hal.h"
+#include <string.h>
+#include "sampler.h"
+#include "setup.h"
+#include "MS5637.h"
+#include "hdc1080.h"
+
+extern I2C_HandleTypeDef hi2c1;
+
+typedef enum
+{
+	SAMPLER_IDLE,				// waiting for next sampling period
+	SAMPLER_CONVERTING,	// hdc1080 and MS5637 conversions running
+} sampler_state_t;
+
+static sampler_state_t		state;
+static uint32_t						tlast;						// HAL tick of last sampling start
+static uint8_t						sampled;					// at least one sample set completed
+static MS5637_cal_t				Pcal;							// calibration constants from MS5637 PROM registers
+static MS5637_conv_t			pconv;						// MS5637 conversion state
+static hdc1080_conv_t			hconv;						// hdc1080 conversion state
+static sampler_snapshot_t	snapshot;					// latest completed sample set
+static sampler_snapshot_t	next;							// sample set being acquired
+static sampler_snapshot_t	latched;					// first sample set completed after trigger
+static uint8_t						latch_state;			// SAMPLER_LATCH_xxx
+static uint8_t						latch_tag;				// tag from trigger
+static uint8_t						trigger;					// start next sample set right away and latch it
+static uint8_t						latch_cycle;			// running sample set will be latched
+
+
+/* Acquisition cycle events to the trace hook, nothing in normal builds */
+#ifdef SAMPLER_TRACE_HOOK
+#define SAMPLER_TRACE(ev)	sampler_trace_hook(ev)
+#else
+#define SAMPLER_TRACE(ev)
+#endif
+
+
+/* Reset pressure sensor and cache its calibration, call once after I2C init */
+void sampler_init(void)
+{
+	MS5637_reset(&hi2c1);
+	HAL_Delay(3);             // PROM reload after reset takes 2.8 ms
+	MS5637_read_calibration(&hi2c1, &Pcal);
+	
+	memset(&snapshot, 0, sizeof(snapshot));
+	sampled = 0;
+	latch_state = SAMPLER_LATCH_NONE;
+	trigger = 0;
+	latch_cycle = 0;
+	state = SAMPLER_IDLE;
+	tlast = HAL_GetTick() - SETUP_SAMPLE_PERIOD;   // first sample set right away
+}
+
+
+/* Advance hdc1080 part of the cycle, returns 1 while it is still running */
+static uint8_t sampler_poll_hdc1080(void)
+{
+	switch (hconv.state)
+	{
+		case HDC1080_CONV_IDLE:   // not started yet or dropped by on demand measurement
+			SAMPLER_TRACE(SAMPLER_TRACE_HDC1080_START);
+			return (hdc1080_conv_start(&hi2c1, &hconv, SAMPLER_T_RES, SAMPLER_RH_RES, 0) == HAL_OK);
+		
+		case HDC1080_CONV_BUSY:
+			if (hdc1080_conv_poll(&hi2c1, &hconv) == HAL_BUSY)
+				return 1;
+			if (hconv.state == HDC1080_CONV_DONE)
+			{
+				next.temperature = hdc1080_temperature(hconv.temperature);
+				next.humidity = hdc1080_humidity(hconv.humidity);
+				next.bat = hconv.bat_stat;
+				next.valid |= SAMPLER_VALID_HDC1080;
+			}
+			SAMPLER_TRACE(SAMPLER_TRACE_HDC1080_DONE);
+			return 0;
+		
+		default:
+			return 0;
+	}
+}
+
+
+/* Advance MS5637 part of the cycle, returns 1 while it is still running */
+static uint8_t sampler_poll_pressure(void)
+{
+	switch (pconv.state)
+	{
+		case MS5637_CONV_IDLE:    // not started yet or dropped by on demand measurement
+			if (!Pcal.valid)    // boot read failed or reload requested
+				MS5637_read_calibration(&hi2c1, &Pcal);
+			SAMPLER_TRACE(SAMPLER_TRACE_MS5637_START);
+			return (MS5637_conv_start(&hi2c1, &pconv, SAMPLER_OSR) == HAL_OK);
+		
+		case MS5637_CONV_D1:
+		case MS5637_CONV_D2:
+			if (MS5637_conv_poll(&hi2c1, &pconv) == HAL_BUSY)
+				return 1;
+			if ((pconv.state == MS5637_CONV_DONE) & (Pcal.valid))
+			{
+				next.D1 = pconv.D1;
+				next.D2 = pconv.D2;
+				if (MS5637_Calculate_int(Pcal.C, next.D1, next.D2, &next.pTemperature, &next.pressure) == HAL_OK)
+					next.valid |= SAMPLER_VALID_MS5637;     // out of sensor range otherwise
+			}
+			SAMPLER_TRACE(SAMPLER_TRACE_MS5637_DONE);
+			return 0;
+		
+		default:
+			return 0;
+	}
+}
+
+
+/* 
+ * Run sampling, call from main loop 
+ *
+ * Both sensors share the I2C bus but convert independently, so their 
+ * conversions are started together and their trigger/readout transfers
+ * interleave. A sample set takes about the longer of the two conversion
+ * sequences instead of their sum.
+ */
+void sampler_process(void)
+{
+	uint8_t busy;
+	
+	switch (state)
+	{
+		case SAMPLER_IDLE:
+			if (((HAL_GetTick() - tlast) < SETUP_SAMPLE_PERIOD) & (!trigger))
+				break;
+			tlast = HAL_GetTick();
+			latch_cycle = trigger;
+			trigger = 0;
+			SAMPLER_TRACE(SAMPLER_TRACE_CYCLE_START);
+			next.valid = 0;
+			hconv.state = HDC1080_CONV_IDLE;
+			pconv.state = MS5637_CONV_IDLE;
+			state = SAMPLER_CONVERTING;
+		// no break, start conversions right away
+		
+		case SAMPLER_CONVERTING:
+			busy  = sampler_poll_hdc1080();
+			busy |= sampler_poll_pressure();
+			if (busy)
+				break;
+			next.timestamp = HAL_GetTick();
+			memcpy(&snapshot, &next, sizeof(snapshot));
+			sampled = 1;
+			if (latch_cycle)
+			{
+				memcpy(&latched, &next, sizeof(latched));
+				latch_state = SAMPLER_LATCH_READY;
+				latch_cycle = 0;
+			}
+			state = SAMPLER_IDLE;
+			SAMPLER_TRACE(SAMPLER_TRACE_CYCLE_DONE);
+		break;
+	}
+}
+
+
+/* 
+ * Start a sample set now, or right after the running one, and latch it 
+ * for sampler_collect(). Meant for a broadcast trigger so that all nodes 
+ * measure in parallel.
+ */
+void sampler_trigger(uint8_t tag)
+{
+	latch_tag = tag;
+	latch_state = SAMPLER_LATCH_PENDING;
+	latch_cycle = 0;      // running set was started before the trigger
+	trigger = 1;
+}
+
+
+/* Latched sample set with tag of its trigger and age in ms, returns SAMPLER_LATCH_xxx */
+uint8_t sampler_collect(uint8_t *tag, const sampler_snapshot_t **s, uint16_t *age)
+{
+	uint32_t a = HAL_GetTick() - latched.timestamp;
+	
+	*tag = latch_tag;
+	*s = &latched;
+	*age = (a >= SAMPLER_AGE_UNKNOWN) ? SAMPLER_AGE_UNKNOWN : (uint16_t)a;
+	return latch_state;
+}
+
+
+/* Latest completed sample set */
+const sampler_snapshot_t *sampler_snapshot(void)
+{
+	return &snapshot;
+}
+
+
+/* Age of the latest sample set in ms, SAMPLER_AGE_UNKNOWN when there is none */
+uint16_t sampler_age(void)
+{
+	uint32_t age = HAL_GetTick() - snapshot.timestamp;
+	
+	if ((!sampled) | (age >= SAMPLER_AGE_UNKNOWN))
+		return SAMPLER_AGE_UNKNOWN;
+	return (uint16_t)age;
+}
+
+
+/* Cached MS5637 calibration coefficients */
+const MS5637_cal_t *sampler_calibration(void)
+{
+	if (!Pcal.valid)
+		MS5637_read_calibration(&hi2c1, &Pcal);
+	return &Pcal;
+}
+
+
+/* Drop and re-read cached MS5637 calibration */
+HAL_StatusTypeDef sampler_reload_calibration(void)
+{
+	MS5637_invalidate_calibration(&Pcal);
+	return MS5637_read_calibration(&hi2c1, &Pcal);
+}
+
+
+/* 
+ * On demand measurements with latency budget
+ *
+ * Worst case time of one conversion step is its conversion time + 1 ms for
+ * the tick phase + 1 ms for I2C transfers. The hdc1080 times are typical,
+ * its result read may be NACKed for HDC1080_READY_TIMEOUT ms more. When the
+ * background cycle has a conversion running on the same sensor, that part
+ * of the cycle is dropped and restarted later, but the sensor is busy until
+ * the conversion ends.
+ */
+#define SAMPLER_STEP_MS(tconv)		((tconv) + 2)
+
+/* hdc1080 resolutions, best first: {temperature, humidity} */
+static const uint8_t sampler_hdc_t_first[3][2] = {
+	{ HDC1080_T_RES_14, HDC1080_RH_RES_14 },
+	{ HDC1080_T_RES_14, HDC1080_RH_RES8 },
+	{ HDC1080_T_RES_11, HDC1080_RH_RES8 },
+};
+static const uint8_t sampler_hdc_rh_first[4][2] = {
+	{ HDC1080_T_RES_14, HDC1080_RH_RES_14 },
+	{ HDC1080_T_RES_11, HDC1080_RH_RES_14 },
+	{ HDC1080_T_RES_11, HDC1080_RH_RES_11 },
+	{ HDC1080_T_RES_11, HDC1080_RH_RES8 },
+};
+static const uint8_t sampler_osr[6] = { 
+	MS5637_OSR_8192, MS5637_OSR_4096, MS5637_OSR_2048, 
+	MS5637_OSR_1024, MS5637_OSR_512, MS5637_OSR_256 
+};
+
+
+/* Time in ms until a running conversion of the background cycle ends */
+static uint16_t sampler_busy(uint32_t tstart, uint8_t tconv)
+{
+	uint32_t elapsed = HAL_GetTick() - tstart;
+	
+	if (elapsed > tconv)
+		return 0;
+	return tconv + 1 - elapsed;
+}
+
+
+/* Wait until the dropped background conversion has ended */
+static void sampler_wait(uint16_t busy)
+{
+	uint32_t t0 = HAL_GetTick();
+	
+	while ((HAL_GetTick() - t0) < busy)
+	{
+	}
+}
+
+
+/*
+ * sampler_measure_hdc1080() - Fresh hdc1080 reading within latency budget
+ * @budget_ms		: maximum time for the measurement
+ * @humidity		: 1 to prefer humidity resolution, 0 for temperature
+ * @temp_res, @humidres : selected resolution
+ * @temperature	: 0.01 degC
+ * @rh					: 0.01 RH%
+ * Returns HAL_TIMEOUT when no resolution fits the budget, nothing is measured then.
+ */
+HAL_StatusTypeDef sampler_measure_hdc1080(uint16_t budget_ms, uint8_t humidity, uint8_t *temp_res, uint8_t *humidres, int16_t *temperature, uint16_t *rh)
+{
+	const uint8_t (*res)[2] = humidity ? sampler_hdc_rh_first : sampler_hdc_t_first;
+	uint8_t i, n = humidity ? 4 : 3;
+	uint8_t running = (state == SAMPLER_CONVERTING) & (hconv.state == HDC1080_CONV_BUSY);
+	uint16_t busy = 0;
+	HAL_StatusTypeDef error;
+	hdc1080_conv_t conv;
+	
+	if (running)
+		busy = sampler_busy(hconv.tstart, hconv.tconv + HDC1080_READY_TIMEOUT);
+	
+	for (i=0; i<n; i++)
+		if (busy + SAMPLER_STEP_MS(hdc1080_conversion_time(res[i][0], res[i][1]) + HDC1080_READY_TIMEOUT) <= budget_ms)
+			break;
+	if (i == n)
+		return HAL_TIMEOUT;
+	
+	if (running)   // background result would be lost anyway, restart it later
+	{
+		hconv.state = HDC1080_CONV_IDLE;
+		sampler_wait(busy);
+	}
+	
+	*temp_res = res[i][0];
+	*humidres = res[i][1];
+	error = hdc1080_conv_start(&hi2c1, &conv, *temp_res, *humidres, 0);
+	if (error != HAL_OK) return error;
+	do 
+	{
+		error = hdc1080_conv_poll(&hi2c1, &conv);
+	} while (error == HAL_BUSY);
+	if (error != HAL_OK) return error;
+	
+	*temperature = hdc1080_temperature(conv.temperature);
+	*rh = hdc1080_humidity(conv.humidity);
+	return HAL_OK;
+}
+
+
+/*
+ * sampler_measure_pressure() - Fresh MS5637 reading within latency budget
+ * @budget_ms		: maximum time for the measurement
+ * @osr					: selected oversampling ratio
+ * @temperature	: 0.01 degC
+ * @pressure		: 0.01 mbar
+ * Returns HAL_TIMEOUT when no OSR fits the budget, nothing is measured then.
+ */
+HAL_StatusTypeDef sampler_measure_pressure(uint16_t budget_ms, uint8_t *osr, int32_t *temperature, int32_t *pressure)
+{
+	uint8_t i;
+	uint8_t running = (state == SAMPLER_CONVERTING) & ((pconv.state == MS5637_CONV_D1) | (pconv.state == MS5637_CONV_D2));
+	uint16_t busy = 0;
+	HAL_StatusTypeDef error;
+	MS5637_conv_t conv;
+	
+	if (running)
+		busy = sampler_busy(pconv.tstart, MS5637_conversion_time(pconv.osr));
+	
+	for (i=0; i<sizeof(sampler_osr); i++)   // D1 and D2 conversion
+		if (busy + 2*SAMPLER_STEP_MS(MS5637_conversion_time(sampler_osr[i])) <= budget_ms)
+			break;
+	if (i == sizeof(sampler_osr))
+		return HAL_TIMEOUT;
+	
+	if (running)   // background result would be lost anyway, restart it later
+	{
+		pconv.state = MS5637_CONV_IDLE;
+		sampler_wait(busy);
+	}
+	if (!Pcal.valid)
+		return HAL_ERROR;
+	
+	*osr = sampler_osr[i];
+	error = MS5637_conv_start(&hi2c1, &conv, *osr);
+	if (error != HAL_OK) return error;
+	do 
+	{
+		error = MS5637_conv_poll(&hi2c1, &conv);
+	} while (error == HAL_BUSY);
+	if (error != HAL_OK) return error;
+	
+	return MS5637_Calculate_int(Pcal.C, conv.D1, conv.D2, temperature, pressure);
+}
+
+
+/* Copyright (c) 2016 S54MTB			********* End Of File   ********/
@@ -15,32 +15,335 @@
 #include <string.h>
 #include "serial.h"
 #include "setup.h"
+#include "hdlc.h"
 
 extern UART_HandleTypeDef huart2;
-extern void hdlc_process_rx_byte(uint8_t rx_byte);
+
+static uint8_t uart_rx_ring[UART_RX_RING];  // written by DMA
+static uint16_t uart_rx_tail = 0;           // next byte for the decoder
+#ifdef SETUP_MUTEMODE
+static uint16_t uart_rx_mark;               // ring position of the next address mark character
+static uint8_t  uart_rx_mark_pending = 0;   // muted, address mark not yet in the ring
+#endif
+
+static volatile uint8_t uart_tx_busy = 0;   // DMA transmission running
+static uint32_t uart_tx_tstart;             // HAL tick at start of transmission
+static uint32_t uart_tx_time;               // max. time of transmission in ms
+
+static uint8_t  uart_baud_change = 0;       // switch rate when reply is out
+static uint32_t uart_baud_next;             // rate to switch to, UART_BAUD_AUTO for detection
+static uint8_t  uart_baud_session = 0;      // running at other than boot rate
+static volatile uint32_t uart_baud_tvalid;  // HAL tick of last valid frame, set by decoder
+
+/**
+ * Start continuous reception to the ring buffer. Character match on the
+ * HDLC flag and idle line run the decoder in interrupt context once per 
+ * frame instead of once per byte, complete frames are queued for
+ * hdlc_process().
+ */
+void uart_rx_start(void)
+{
+#ifdef SETUP_MUTEMODE
+	// ADD holds node address, no character match, frames end on idle line
+	HAL_MultiProcessorEx_AddressLength_Set(&huart2, UART_ADDRESS_DETECT_7B);
+	HAL_MultiProcessor_Init(&huart2, SETUP_OWNADDRESS & 0x7f, UART_WAKEUPMETHOD_ADDRESSMARK);
+	HAL_MultiProcessor_EnableMuteMode(&huart2);
+	__HAL_UART_DISABLE(&huart2);
+#else
+	// match character and overrun handling can be changed only when disabled
+	__HAL_UART_DISABLE(&huart2);
+	huart2.Instance->CR2 = (huart2.Instance->CR2 & ~USART_CR2_ADD) | 
+	                       ((uint32_t)HDLC_FLAG_SOF << UART_CR2_ADDRESS_LSB_POS);
+#endif
+	huart2.Instance->CR3 |= USART_CR3_OVRDIS;   // DMA keeps running on overrun
+	__HAL_UART_ENABLE(&huart2);
+	
+	uart_rx_tail = 0;
+	HAL_UART_Receive_DMA(&huart2, uart_rx_ring, UART_RX_RING);
+#ifndef SETUP_MUTEMODE
+	__HAL_UART_ENABLE_IT(&huart2, UART_IT_CM);
+#endif
+	__HAL_UART_ENABLE_IT(&huart2, UART_IT_IDLE);
+	__HAL_UART_ENABLE_IT(&huart2, UART_IT_ERR);   // line errors are cleared in uart_rx_irq()
+	uart_rx_mute();
+}
+
+
+/**
+ * Mute receiver until next address mark with own address. Foreign 
+ * frames then never reach the ring. Does nothing without SETUP_MUTEMODE.
+ * The address character that wakes the receiver is the next one written 
+ * to the ring, uart_rx_drain() keeps it away from the HDLC decoder.
+ */
+void uart_rx_mute(void)
+{
+#ifdef SETUP_MUTEMODE
+	HAL_MultiProcessor_EnterMuteMode(&huart2);
+	uart_rx_mark = (UART_RX_RING - __HAL_DMA_GET_COUNTER(huart2.hdmarx)) % UART_RX_RING;
+	uart_rx_mark_pending = 1;
+#endif
+}
+
+
+/* Feed ring up to head to the HDLC decoder */
+static void uart_rx_feed(uint16_t head)
+{
+	if (head < uart_rx_tail)  // wrapped, first the part up to the end of ring
+	{
+		hdlc_process_rx(&uart_rx_ring[uart_rx_tail], UART_RX_RING - uart_rx_tail);
+		uart_rx_tail = 0;
+	}
+	if (head > uart_rx_tail)
+	{
+		hdlc_process_rx(&uart_rx_ring[uart_rx_tail], head - uart_rx_tail);
+		uart_rx_tail = head;
+	}
+}
+
+
+/**
+ * Feed received bytes to the HDLC decoder. Called from USART and DMA 
+ * interrupts, both run at the same priority and never nest.
+ */
+static void uart_rx_drain(void)
+{
+	uint16_t head;
+	
+	head = UART_RX_RING - __HAL_DMA_GET_COUNTER(huart2.hdmarx);
+	if (head == UART_RX_RING)
+		head = 0;
+	
+#ifdef SETUP_MUTEMODE
+	// muted receiver writes nothing until the address mark, so any new byte 
+	// past the mark position means the address character is in
+	if (uart_rx_mark_pending && (head != uart_rx_mark))
+	{
+		uart_rx_feed(uart_rx_mark);     // characters received before mute took effect
+		uart_rx_tail = (uart_rx_mark + 1) % UART_RX_RING;
+		uart_rx_mark_pending = 0;
+	}
+#endif
+	uart_rx_feed(head);
+}
+
+
+/* 
+ * Character match, idle line and line errors, call from USART2_IRQHandler()
+ * before HAL_UART_IRQHandler(). HAL would end the reception on a line error
+ * (State READY) while the DMA ring keeps running, so FE, NE, ORE and PE are
+ * cleared here first. The character is in the ring anyway and its frame 
+ * fails the CRC check.
+ */
+void uart_rx_irq(void)
+{
+	if (huart2.Instance->ISR & (USART_ISR_PE | USART_ISR_FE | USART_ISR_NE | USART_ISR_ORE))
+	{
+		__HAL_UART_CLEAR_IT(&huart2, UART_CLEAR_PEF | UART_CLEAR_FEF | UART_CLEAR_NEF | UART_CLEAR_OREF);
+	}
+	if (__HAL_UART_GET_FLAG(&huart2, UART_FLAG_CMF))
+	{
+		__HAL_UART_CLEAR_IT(&huart2, UART_CLEAR_CMF);
+		uart_rx_drain();
+	}
+	if (__HAL_UART_GET_FLAG(&huart2, UART_FLAG_IDLE))
+	{
+		__HAL_UART_CLEAR_IT(&huart2, UART_CLEAR_IDLEF);
+		uart_rx_drain();
+	}
+}
+
+
+/* Ring half and fully written, drain it before DMA wraps over unread data */
+void HAL_UART_RxHalfCpltCallback(UART_HandleTypeDef *huart)
+{
+	uart_rx_drain();
+}
+
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
+{
+	uart_rx_drain();
+}
+
+
+/* 
+ * DMA transfer error, the channel is disabled by hardware and HAL has set
+ * State READY. Hand over what is in the ring and start reception over.
+ */
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+	uart_rx_drain();
+	HAL_DMA_Abort(huart->hdmarx);     // unlock channel for restart
+	huart->ErrorCode = HAL_UART_ERROR_NONE;
+	uart_rx_tail = 0;
+	HAL_UART_Receive_DMA(huart, uart_rx_ring, UART_RX_RING);
+	uart_rx_mute();     // frame in progress is lost, wait for next address mark
+}
+
+
+/* Reconfigure USART2 to new rate and restart reception */
+static void uart_set_baudrate(uint32_t baud, uint8_t autobaud)
+{
+	uart_tx_wait();
+	HAL_NVIC_DisableIRQ(USART2_IRQn);
+	HAL_NVIC_DisableIRQ(DMA1_Channel4_5_IRQn);
+	
+	HAL_UART_DMAStop(&huart2);
+	hdlc_rx_reset();                  // bytes so far were at the old rate
+	huart2.Init.BaudRate = baud;      // start value for auto baud rate detection
+	huart2.AdvancedInit.AdvFeatureInit = UART_ADVFEATURE_AUTOBAUDRATE_INIT;
+	huart2.AdvancedInit.AutoBaudRateEnable = autobaud ? UART_ADVFEATURE_AUTOBAUDRATE_ENABLE :
+	                                                    UART_ADVFEATURE_AUTOBAUDRATE_DISABLE;
+	huart2.AdvancedInit.AutoBaudRateMode = UART_ADVFEATURE_AUTOBAUDRATE_ON0X7FFRAME;
+	HAL_RS485Ex_Init(&huart2, UART_DE_POLARITY_HIGH, SETUP_DE_ASSERT, SETUP_DE_DEASSERT);
+	uart_rx_start();
+	
+	HAL_NVIC_EnableIRQ(DMA1_Channel4_5_IRQn);
+	HAL_NVIC_EnableIRQ(USART2_IRQn);
+	
+	uart_baud_session = (baud != SETUP_BAUDRATE) | autobaud;
+	uart_baud_tvalid = HAL_GetTick();
+}
+
+
+/*
+ * uart_baud_request() - Switch rate after the reply to this request
+ * @baud:  new rate, UART_BAUD_AUTO for auto baud rate detection on 0x7F
+ *         character (with SETUP_AUTOBAUD) 
+ * Returns HAL_ERROR for unsupported rate.
+ */
+HAL_StatusTypeDef uart_baud_request(uint32_t baud)
+{
+	if (baud == UART_BAUD_AUTO)
+	{
+#ifndef SETUP_AUTOBAUD
+		return HAL_ERROR;
+#endif
+	}
+	else if ((baud < SETUP_BAUDRATE) | (baud > SETUP_BAUD_MAX))
+		return HAL_ERROR;
+	
+	uart_baud_next = baud;
+	uart_baud_change = 1;
+	return HAL_OK;
+}
+
+
+/* Current rate, measured rate after auto baud rate detection */
+uint32_t uart_baudrate(void)
+{
+	if ((huart2.Instance->CR2 & USART_CR2_ABREN) && (huart2.Instance->BRR != 0))
+		return HAL_RCC_GetPCLK1Freq() / huart2.Instance->BRR;
+	return huart2.Init.BaudRate;
+}
+
+
+/* Frame with valid CRC on the line, for any node, keeps the negotiated rate.
+   Called by the HDLC decoder in interrupt context. */
+void uart_baud_keepalive(void)
+{
+	uart_baud_tvalid = HAL_GetTick();
+}
+
 
 /**
- * Process received char, check if LF or CR received
- * Set flag when line is done
+ * Apply requested rate, fall back to SETUP_BAUDRATE when no valid frame
+ * was on the line for SETUP_BAUD_TIMEOUT ms. Call from main loop after 
+ * hdlc_process().
  */
-void process_rx_char(char rx_char)
+void uart_baud_process(void)
 {
-  hdlc_process_rx_byte(rx_char);
+	uint32_t tvalid = uart_baud_tvalid;   // before the tick, decoder may move it on
+	
+	if (uart_baud_change)
+	{
+		uart_baud_change = 0;
+		if (uart_baud_next == UART_BAUD_AUTO)
+			uart_set_baudrate(SETUP_BAUDRATE, 1);
+		else
+			uart_set_baudrate(uart_baud_next, 0);
+	}
+	else if (uart_baud_session && ((HAL_GetTick() - tvalid) > SETUP_BAUD_TIMEOUT))
+	{
+		uart_set_baudrate(SETUP_BAUDRATE, 0);
+	}
 }
 
 
 void uart_puts(char *str)
 {
-	uint16_t len = strlen(str);
-	HAL_UART_Transmit_IT(&huart2, (uint8_t *)str, len);
-	HAL_Delay(len*2);  // foolproof
+	uart_write((uint8_t *)str, strlen(str));
+	uart_tx_wait();    // str may not live until sent
+}
+
+
+/* 
+ * Lost TC interrupt. Stop the TX DMA channel, it must not read the buffer 
+ * while the next reply is written to it, and give HAL back the receive 
+ * state it sets on TC. Otherwise HAL_UART_Transmit_DMA() stays HAL_BUSY 
+ * for good. Circular reception keeps running.
+ */
+static void uart_tx_abort(void)
+{
+	__disable_irq();
+	if (uart_tx_busy)
+	{
+		huart2.Instance->CR3 &= ~USART_CR3_DMAT;
+		__HAL_UART_DISABLE_IT(&huart2, UART_IT_TC);
+		HAL_DMA_Abort(huart2.hdmatx);
+		huart2.State = (huart2.Instance->CR3 & USART_CR3_DMAR) ? HAL_UART_STATE_BUSY_RX : HAL_UART_STATE_READY;
+		uart_tx_busy = 0;
+		HAL_GPIO_WritePin(GPIOA, GPIO_PIN_5, GPIO_PIN_RESET );
+	}
+	__enable_irq();
+}
+
+
+/**
+ * Wait for the end of the previous transmission. The core sleeps
+ * meanwhile, time limit is twice the time of the frame on the wire.
+ */
+void uart_tx_wait(void)
+{
+	while (uart_tx_busy)
+	{
+		__disable_irq();
+		if (uart_tx_busy)
+			__WFI();        // pending interrupt wakes the core even when masked
+		__enable_irq();
+		if ((HAL_GetTick() - uart_tx_tstart) > uart_tx_time)
+			uart_tx_abort();    // lost TC interrupt, don't hang
+	}
+}
+
+
+/**
+ * Start sending buffer with DMA, buf must stay unchanged until
+ * uart_tx_wait() returns. LED on PA5 is on during transmission.
+ */
+void uart_write(const uint8_t *buf, uint16_t len)
+{
+	uart_tx_wait();
+	
+	// 10 bits per character
+	uart_tx_time = 2 + (20000UL * len) / huart2.Init.BaudRate;
+	uart_tx_tstart = HAL_GetTick();
+	uart_tx_busy = 1;
+	HAL_GPIO_WritePin(GPIOA, GPIO_PIN_5, GPIO_PIN_SET );
+	if (HAL_UART_Transmit_DMA(&huart2, (uint8_t *)buf, len) != HAL_OK)
+	{
+		uart_tx_busy = 0;
+		HAL_GPIO_WritePin(GPIOA, GPIO_PIN_5, GPIO_PIN_RESET );
+	}
 }
 
 
-void uart_putchar(char ch)
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
 {
-	HAL_UART_Transmit_IT(&huart2, (uint8_t *)&ch, 1);
-	HAL_Delay(2);
+	if (huart->Instance == USART2)
+	{
+		uart_tx_busy = 0;
+		HAL_GPIO_WritePin(GPIOA, GPIO_PIN_5, GPIO_PIN_RESET );
+	}
 }
 
 
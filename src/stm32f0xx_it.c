@@ -14,10 +14,14 @@
 #include "stm32f0xx_hal.h"
 #include "stm32f0xx.h"
 #include "stm32f0xx_it.h"
+#include "serial.h"
 
 
 /* External variables --------------------------------------------------------*/
 extern UART_HandleTypeDef huart2;
+extern DMA_HandleTypeDef hdma_usart2_rx;
+extern DMA_HandleTypeDef hdma_usart2_tx;
+extern I2C_HandleTypeDef hi2c1;
 
 /******************************************************************************/
 /*            Cortex-M0 Processor Interruption and Exception Handlers         */ 
@@ -62,9 +66,30 @@ void SysTick_Handler(void)
 */
 void USART2_IRQHandler(void)
 {
+  uart_rx_irq();
   HAL_UART_IRQHandler(&huart2);
  }
 
+/**
+* @brief This function handles DMA1 channel 4 and 5 interrupts.
+*/
+void DMA1_Channel4_5_IRQHandler(void)
+{
+  HAL_DMA_IRQHandler(&hdma_usart2_tx);
+  HAL_DMA_IRQHandler(&hdma_usart2_rx);
+}
+
+/**
+* @brief This function handles I2C1 global interrupt.
+*/
+void I2C1_IRQHandler(void)
+{
+  if (hi2c1.Instance->ISR & (I2C_FLAG_BERR | I2C_FLAG_ARLO | I2C_FLAG_OVR))
+    HAL_I2C_ER_IRQHandler(&hi2c1);
+  else
+    HAL_I2C_EV_IRQHandler(&hi2c1);
+}
+
 
  
 /************************ (C) S54MTB *****END OF FILE****/